@@ -0,0 +1,6 @@
+// texture coordinate passed from the vertex to the fragment stage
+#ifdef VERTEX_SHADER
+out vec2 TexCoord;
+#else
+in vec2 TexCoord;
+#endif
@@ -0,0 +1,37 @@
+#version 330 core
+#include "include/texture_varyings.glsl"
+out vec4 FragColor;
+uniform sampler2D texture1;
+#ifdef ATLAS
+// 两张图片在同一张图集里，各自占 (u0, v0, u1, v1) 的子矩形
+uniform vec4 region1;
+uniform vec4 region2;
+#define texture2 texture1
+#elif defined(MIX_TEXTURE2)
+uniform sampler2D texture2;
+#endif
+
+// feature defines (see utils::ShaderVariants):
+//   FLIP_X        mirror horizontally
+//   MIX_TEXTURE2  blend texture2 over texture1 at 0.2
+//   ATLAS         texture1 is a utils::TextureAtlas page, uv is remapped into region1 / region2
+void main()
+{
+#ifdef FLIP_X
+    vec2 uv = vec2(1.0 - TexCoord.x, TexCoord.y);
+#else
+    vec2 uv = TexCoord;
+#endif
+#ifdef ATLAS
+    vec2 uv1 = mix(region1.xy, region1.zw, uv);
+    vec2 uv2 = mix(region2.xy, region2.zw, uv);
+#else
+    vec2 uv1 = uv;
+    vec2 uv2 = uv;
+#endif
+#ifdef MIX_TEXTURE2
+    FragColor = mix(texture(texture1, uv1), texture(texture2, uv2), 0.2);
+#else
+    FragColor = texture(texture1, uv1);
+#endif
+}
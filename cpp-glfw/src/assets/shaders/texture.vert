@@ -0,0 +1,10 @@
+#version 330 core
+#include "include/texture_varyings.glsl"
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+void main()
+{
+   gl_Position = vec4(aPos, 1.0);
+   TexCoord = aTexCoord;
+}
@@ -0,0 +1,206 @@
+#include "utils/gl_state.h"
+#include "utils/glfw_module.h"
+#include "utils/shader_variants.h"
+#include "utils/tile_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 每格滚轮的缩放倍数
+constexpr double ZOOM_STEP = 1.2;
+// 最多放大到一个图片像素占 32 个屏幕像素
+constexpr double MAX_SCALE = 32.0;
+
+// 查看 .gltiles 分块金字塔（tile-pyramid 生成），图片可以远大于 GL_MAX_TEXTURE_SIZE。
+// 左键拖动平移，滚轮以光标为中心缩放；只有可见的瓦片在 TileCache 里常驻，加载中的位置先显示更粗的一级
+class DeepZoomApp
+{
+public:
+    DeepZoomApp(utils::GlfwModule& module, std::string image_path)
+        : module_(module), image_path_(std::move(image_path)),
+          shaders_{module.GetAssetPath("shaders/texture.vert"), module.GetAssetPath("shaders/texture.frag"), {}}
+    {
+    }
+
+    bool Init()
+    {
+        std::string error;
+        if (!tiles_.Open(image_path_, &error))
+        {
+            utils::ShowErrorMessage("Failed to open " + image_path_ + " (" + error + ")");
+            return false;
+        }
+
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+        gl_state_.BindVertexArray(vao_);
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, 0);
+        gl_state_.BindVertexArray(0);
+
+        shader_ = &shaders_.Get(0);
+        shader_->Use();
+        shader_->SetInt("texture1", 0);
+
+        // 整张图片放进窗口
+        int width = 0;
+        int height = 0;
+        module_.GetFramebufferSize(width, height);
+        fit_scale_ =
+            std::min(static_cast<double>(width) / tiles_.Width(), static_cast<double>(height) / tiles_.Height());
+        scale_ = fit_scale_;
+        center_x_ = tiles_.Width() * 0.5;
+        center_y_ = tiles_.Height() * 0.5;
+        return true;
+    }
+
+    void Render()
+    {
+        int width = 0;
+        int height = 0;
+        module_.GetFramebufferSize(width, height);
+        HandleInput(width, height);
+
+        double half_width = width * 0.5 / scale_;
+        double half_height = height * 0.5 / scale_;
+        quads_.clear();
+        tiles_.Collect(center_x_ - half_width, center_y_ - half_height, center_x_ + half_width, center_y_ + half_height,
+                       scale_, quads_);
+
+        // 每块瓦片两个三角形，图片坐标换算到 NDC（图片的 y 向下）
+        vertices_.clear();
+        for (utils::TileQuad const& quad : quads_)
+        {
+            GLfloat x0 = static_cast<GLfloat>((quad.x0 - center_x_) / half_width);
+            GLfloat x1 = static_cast<GLfloat>((quad.x1 - center_x_) / half_width);
+            GLfloat y0 = static_cast<GLfloat>((center_y_ - quad.y0) / half_height);
+            GLfloat y1 = static_cast<GLfloat>((center_y_ - quad.y1) / half_height);
+            // clang-format off
+            GLfloat corners[] = {
+                x0, y0, 0.0f, quad.u0, quad.v0,
+                x1, y0, 0.0f, quad.u1, quad.v0,
+                x1, y1, 0.0f, quad.u1, quad.v1,
+                x0, y0, 0.0f, quad.u0, quad.v0,
+                x1, y1, 0.0f, quad.u1, quad.v1,
+                x0, y1, 0.0f, quad.u0, quad.v1,
+            };
+            // clang-format on
+            vertices_.insert(vertices_.end(), std::begin(corners), std::end(corners));
+        }
+
+        if (!vertices_.empty())
+        {
+            gl_state_.BindBuffer(GL_ARRAY_BUFFER, vbo_);
+            // 每帧重新指定整个缓冲，驱动可以换一块新内存，不必等上一帧的绘制
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices_.size() * sizeof(GLfloat)),
+                         vertices_.data(), GL_STREAM_DRAW);
+            shader_->Use();
+            gl_state_.BindTexture(0, GL_TEXTURE_2D, tiles_.CacheTexture()->Id());
+            gl_state_.BindVertexArray(vao_);
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices_.size() / 5));
+        }
+
+        // 本帧缺少的瓦片在这之后才开始加载，上传的瓦片下一帧才画得出来
+        bool loading = tiles_.Update();
+        module_.SetAnimating(loading || dragging_);
+    }
+
+    void Shutdown()
+    {
+        utils::TileCache::Stats stats = tiles_.GetStats();
+        std::cout << image_path_ << ": " << tiles_.Width() << "x" << tiles_.Height() << ", " << tiles_.LevelCount()
+                  << " levels, tiles loaded " << stats.loaded << ", evicted " << stats.evicted << ", resident "
+                  << stats.resident << "/" << stats.capacity << "\n";
+        gl_state_.DeleteVertexArrays(1, &vao_);
+        gl_state_.DeleteBuffers(1, &vbo_);
+    }
+
+private:
+    void HandleInput(int width, int height)
+    {
+        double cursor_x = 0.0;
+        double cursor_y = 0.0;
+        module_.GetCursorPosition(cursor_x, cursor_y);
+
+        bool pressed = module_.IsMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT);
+        if (pressed && dragging_)
+        {
+            center_x_ -= (cursor_x - last_cursor_x_) / scale_;
+            center_y_ -= (cursor_y - last_cursor_y_) / scale_;
+        }
+        dragging_ = pressed;
+        last_cursor_x_ = cursor_x;
+        last_cursor_y_ = cursor_y;
+
+        // 缩放前后光标下的图片位置不变
+        double scroll = module_.TakeScrollOffset();
+        if (scroll != 0.0)
+        {
+            double offset_x = cursor_x - width * 0.5;
+            double offset_y = cursor_y - height * 0.5;
+            double anchor_x = center_x_ + offset_x / scale_;
+            double anchor_y = center_y_ + offset_y / scale_;
+            scale_ = std::clamp(scale_ * std::pow(ZOOM_STEP, scroll), fit_scale_ * 0.5, MAX_SCALE);
+            center_x_ = anchor_x - offset_x / scale_;
+            center_y_ = anchor_y - offset_y / scale_;
+        }
+
+        // 至少留一半图片在视野里
+        center_x_ = std::clamp(center_x_, 0.0, static_cast<double>(tiles_.Width()));
+        center_y_ = std::clamp(center_y_, 0.0, static_cast<double>(tiles_.Height()));
+    }
+
+private:
+    utils::GlfwModule& module_;
+    std::string image_path_;
+    utils::GLStateCache& gl_state_ = utils::GLStateCache::Current();
+    // 与纹理示例共用 texture.vert / texture.frag，纹理坐标直接指向缓存纹理里的槽位
+    utils::ShaderVariants shaders_;
+    utils::Shader* shader_ = nullptr;
+    utils::TileCache tiles_;
+    GLuint vbo_ = 0;
+    GLuint vao_ = 0;
+    std::vector<utils::TileQuad> quads_;
+    std::vector<GLfloat> vertices_;
+    // 视野中心（图片像素）和每个图片像素对应的屏幕像素
+    double center_x_ = 0.0;
+    double center_y_ = 0.0;
+    double scale_ = 1.0;
+    double fit_scale_ = 1.0;
+    bool dragging_ = false;
+    double last_cursor_x_ = 0.0;
+    double last_cursor_y_ = 0.0;
+};
+
+int main(int argc, char* argv[])
+{
+    auto module = utils::GlfwModule(utils::ParseCommandLine(argc, argv));
+    if (!module.InitializeContext())
+    {
+        return -1;
+    }
+
+    // --image FILE 指定要查看的 .gltiles，默认是构建时由 container.jpeg 切出来的小图
+    std::string image_path = module.GetAssetPath("cooked/container.gltiles");
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--image") == 0)
+        {
+            image_path = argv[i + 1];
+        }
+    }
+
+    DeepZoomApp app(module, image_path);
+    module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
+    // 没有输入、也没有瓦片在加载时不重绘
+    module.SetRedrawMode(utils::RedrawMode::OnDemand);
+    return module.Run(app) ? 0 : -1;
+}
@@ -0,0 +1,61 @@
+# 以 headless 模式运行每个示例，截取最后一帧并与 golden 目录下的参考图片比较，
+# 同时记录每个示例的帧时间，结果写入 ${OUT_DIR}/golden_report.jsonl
+#
+# 参数（-D 传入）:
+#   SAMPLES      逗号分隔的示例程序名
+#   BIN_DIR      示例程序所在目录
+#   IMAGE_DIFF   image-diff 程序路径
+#   GOLDEN_DIR   参考图片目录
+#   OUT_DIR      截图和报告的输出目录
+#   FRAMES       每个示例渲染的帧数
+#   UPDATE       为 ON 时用本次截图覆盖参考图片
+#   EXE_SUFFIX   可执行文件后缀
+
+string(REPLACE "," ";" sample_list "${SAMPLES}")
+file(MAKE_DIRECTORY "${OUT_DIR}")
+set(report "${OUT_DIR}/golden_report.jsonl")
+file(WRITE "${report}" "")
+
+set(failures 0)
+foreach(sample IN LISTS sample_list)
+  set(capture "${OUT_DIR}/${sample}.png")
+  set(reference "${GOLDEN_DIR}/${sample}.png")
+  file(REMOVE "${capture}")
+
+  execute_process(
+    COMMAND "${BIN_DIR}/${sample}${EXE_SUFFIX}" --headless --bench --warmup 0 --frames ${FRAMES} --capture "${capture}"
+    RESULT_VARIABLE run_result
+    OUTPUT_VARIABLE run_output
+  )
+  file(APPEND "${report}" "${run_output}")
+  if(NOT run_result EQUAL 0 OR NOT EXISTS "${capture}")
+    message(SEND_ERROR "${sample}: run failed (${run_result})\n${run_output}")
+    math(EXPR failures "${failures} + 1")
+    continue()
+  endif()
+
+  if(UPDATE)
+    file(COPY_FILE "${capture}" "${reference}")
+    message(STATUS "${sample}: reference updated")
+  elseif(NOT EXISTS "${reference}")
+    message(SEND_ERROR "${sample}: missing reference ${reference}, run the golden-update target first")
+    math(EXPR failures "${failures} + 1")
+  else()
+    execute_process(
+      COMMAND "${IMAGE_DIFF}" "${capture}" "${reference}"
+      RESULT_VARIABLE diff_result
+      OUTPUT_VARIABLE diff_output
+    )
+    file(APPEND "${report}" "${diff_output}")
+    if(diff_result EQUAL 0)
+      message(STATUS "${sample}: ok")
+    else()
+      message(SEND_ERROR "${sample}: image mismatch\n${diff_output}")
+      math(EXPR failures "${failures} + 1")
+    endif()
+  endif()
+endforeach()
+
+if(failures GREATER 0)
+  message(FATAL_ERROR "${failures} sample(s) failed, see ${report}")
+endif()
@@ -521,6 +521,13 @@ STBIDEF void stbi_set_unpremultiply_on_load_thread(int flag_true_if_should_unpre
 STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_convert);
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// [cpp-glfw] runtime-dispatched AVX2 kernels (JPEG color conversion and chroma
+// upsampling, PNG filter reconstruction). they are used automatically when the
+// CPU and OS support AVX2; pass 0 to fall back to the SSE2/scalar paths, e.g.
+// to compare them. stbi_avx2_active() reports whether they are in use.
+STBIDEF void stbi_set_avx2_enabled(int flag_true_if_should_enable);
+STBIDEF int  stbi_avx2_active(void);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -789,6 +796,71 @@ static int stbi__sse2_available(void)
 #define STBI_SIMD_ALIGN(type, name) type name
 #endif
 
+// [cpp-glfw] AVX2. unlike SSE2 this is not part of the x64 baseline, so the
+// kernels are compiled with a per-function target attribute and selected at
+// runtime; the rest of the file is still built for the baseline ISA.
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2)
+#if defined(_MSC_VER)
+#if _MSC_VER >= 1700 // VS2012: AVX2 intrinsics, __cpuidex and _xgetbv
+#define STBI_AVX2
+#define STBI__AVX2_TARGET
+#endif
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#define STBI_AVX2
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifdef STBI_AVX2
+#include <immintrin.h>
+
+static int stbi__avx2_enabled = 1;
+static int stbi__avx2_detected = -1; // -1 = not queried yet; racing initializations write the same value
+
+static int stbi__avx2_available(void)
+{
+   if (stbi__avx2_detected < 0) {
+#ifdef _MSC_VER
+      int info[4];
+      int has_avx2 = 0;
+      __cpuid(info, 0);
+      if (info[0] >= 7) {
+         __cpuid(info, 1);
+         // OSXSAVE + AVX, and the OS has to save the YMM registers on context switch
+         if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            has_avx2 = (info[1] >> 5) & 1;
+         }
+      }
+      stbi__avx2_detected = has_avx2;
+#else
+      // also checks that the OS has enabled the YMM state
+      __builtin_cpu_init();
+      stbi__avx2_detected = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+   }
+   return stbi__avx2_enabled && stbi__avx2_detected;
+}
+#endif // STBI_AVX2
+
+STBIDEF void stbi_set_avx2_enabled(int flag_true_if_should_enable)
+{
+#ifdef STBI_AVX2
+   stbi__avx2_enabled = flag_true_if_should_enable;
+#else
+   STBI_NOTUSED(flag_true_if_should_enable);
+#endif
+}
+
+STBIDEF int stbi_avx2_active(void)
+{
+#ifdef STBI_AVX2
+   return stbi__avx2_available();
+#else
+   return 0;
+#endif
+}
+
 #ifndef STBI_MAX_DIMENSIONS
 #define STBI_MAX_DIMENSIONS (1 << 24)
 #endif
@@ -3763,6 +3835,147 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// [cpp-glfw] 16 pixels per iteration; same fixed-point math as the SSE2 version
+STBI__AVX2_TARGET
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   // as in the SSE2 version the last pixel is left to the scalar tail
+   for (; i < ((w-1) & ~15); i += 16) {
+      // vertical pass: 3*near + far = 4*near + (far - near)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i curr  = _mm256_add_epi16(_mm256_slli_epi16(nearw, 2), _mm256_sub_epi16(farw, nearw));
+
+      // "prev"/"next" are curr shifted by one pixel; the shift has to cross the
+      // 128-bit lanes, hence the permute + alignr pairs
+      __m256i lo_in_hi = _mm256_permute2x128_si256(curr, curr, 0x08); // [0, curr.lo]
+      __m256i hi_in_lo = _mm256_permute2x128_si256(curr, curr, 0x81); // [curr.hi, 0]
+      __m256i prev = _mm256_insert_epi16(_mm256_alignr_epi8(curr, lo_in_hi, 14), t1, 0);
+      __m256i next = _mm256_insert_epi16(_mm256_alignr_epi8(hi_in_lo, curr, 2), 3*in_near[i+16] + in_far[i+16], 15);
+
+      // horizontal pass, polyphase: even = 4*cur + (prev - cur), odd = 4*cur + (next - cur)
+      __m256i curb = _mm256_add_epi16(_mm256_slli_epi16(curr, 2), _mm256_set1_epi16(8));
+      __m256i even = _mm256_add_epi16(_mm256_sub_epi16(prev, curr), curb);
+      __m256i odd  = _mm256_add_epi16(_mm256_sub_epi16(next, curr), curb);
+
+      // per-lane interleave + pack keeps the outputs in order:
+      // lane 0 holds outputs 0..15, lane 1 outputs 16..31
+      __m256i de0  = _mm256_srli_epi16(_mm256_unpacklo_epi16(even, odd), 4);
+      __m256i de1  = _mm256_srli_epi16(_mm256_unpackhi_epi16(even, odd), 4);
+      _mm256_storeu_si256((__m256i *) (out + i*2), _mm256_packus_epi16(de0, de1));
+
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+
+// [cpp-glfw] 16 pixels per iteration, same fixed-point math as the SSE2 version.
+// unlike SSE2 this also handles step == 3, which is what you get when loading
+// an RGB JPEG with req_comp == 0.
+STBI__AVX2_TARGET
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 3 || step == 4) {
+      __m128i signflip  = _mm_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+      // drops every 4th byte of each 16-byte lane: 4 RGBA pixels -> 12 RGB bytes + 4 zeros
+      __m256i rgba_to_rgb = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+                                             0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+      // the step == 3 stores write 4 junk bytes past the 16 pixels, which must
+      // still land inside this row (they are overwritten by the next store or the tail)
+      int tail = step == 3 ? 2 : 0;
+
+      for (; i+15+tail < count; i += 16) {
+         // load, bias cr/cb by -128
+         __m128i y_bytes  = _mm_loadu_si128((__m128i *) (y+i));
+         __m128i cr_bytes = _mm_xor_si128(_mm_loadu_si128((__m128i *) (pcr+i)), signflip);
+         __m128i cb_bytes = _mm_xor_si128(_mm_loadu_si128((__m128i *) (pcb+i)), signflip);
+
+         // widen to short: y*256 + 128, cr and cb left-shifted by 8
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(y_bytes), 8), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cr_bytes), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cb_bytes), 8);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte and interleave within each lane:
+         // o0 = pixels 0..3 | 8..11, o1 = pixels 4..7 | 12..15
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // restore pixel order across the lanes
+         __m256i p0 = _mm256_permute2x128_si256(o0, o1, 0x20); // pixels 0..7
+         __m256i p1 = _mm256_permute2x128_si256(o0, o1, 0x31); // pixels 8..15
+
+         if (step == 4) {
+            _mm256_storeu_si256((__m256i *) (out + 0), p0);
+            _mm256_storeu_si256((__m256i *) (out + 32), p1);
+            out += 64;
+         } else {
+            __m256i r0 = _mm256_shuffle_epi8(p0, rgba_to_rgb);
+            __m256i r1 = _mm256_shuffle_epi8(p1, rgba_to_rgb);
+            _mm_storeu_si128((__m128i *) (out + 0), _mm256_castsi256_si128(r0));
+            _mm_storeu_si128((__m128i *) (out + 12), _mm256_extracti128_si256(r0, 1));
+            _mm_storeu_si128((__m128i *) (out + 24), _mm256_castsi256_si128(r1));
+            _mm_storeu_si128((__m128i *) (out + 36), _mm256_extracti128_si256(r1, 1));
+            out += 48;
+         }
+      }
+   }
+
+   stbi__YCbCr_to_RGB_row(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif // STBI_AVX2
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
@@ -3778,6 +3991,15 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
    }
 #endif
 
+#ifdef STBI_AVX2
+   // the IDCT keeps the SSE2 kernel: an 8x8 block of 16-bit coefficients is
+   // exactly eight SSE rows, so 256-bit registers would only add lane shuffles
+   if (stbi__avx2_available()) {
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
    j->idct_block_kernel = stbi__idct_simd;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -4591,6 +4813,99 @@ static int stbi__paeth(int a, int b, int c)
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
 // create the png data from post-deflated data
+#ifdef STBI_AVX2
+// [cpp-glfw] SIMD filter reconstruction for one scanline (minus its first pixel).
+//
+// "up" has no dependency along the row and runs 32 bytes at a time. sub, avg
+// and paeth depend on the pixel just reconstructed, so (like libpng's SSE
+// code) they work one whole pixel per step instead of one byte; that only
+// pays off for 3- and 4-byte pixels, other layouts return 0 and take the
+// scalar path.
+STBI__AVX2_TARGET
+static __m128i stbi__png_load_pixel(stbi_uc const *p, int bpp)
+{
+   stbi__uint32 v = 0;
+   memcpy(&v, p, bpp);
+   return _mm_cvtsi32_si128((int) v);
+}
+
+STBI__AVX2_TARGET
+static void stbi__png_store_pixel(stbi_uc *p, __m128i x, int bpp)
+{
+   stbi__uint32 v = (stbi__uint32) _mm_cvtsi128_si32(x);
+   memcpy(p, &v, bpp);
+}
+
+STBI__AVX2_TARGET
+static int stbi__png_unfilter_row_avx2(int filter, stbi_uc *cur, stbi_uc const *raw, stbi_uc const *prior, int nk, int bpp)
+{
+   int k = 0;
+   __m128i zero = _mm_setzero_si128();
+   __m128i a, b, c;
+
+   if (filter == STBI__F_up) {
+      for (; k + 32 <= nk; k += 32) {
+         __m256i r = _mm256_loadu_si256((__m256i const *) (raw + k));
+         __m256i p = _mm256_loadu_si256((__m256i const *) (prior + k));
+         _mm256_storeu_si256((__m256i *) (cur + k), _mm256_add_epi8(r, p));
+      }
+      for (; k < nk; ++k)
+         cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+      return 1;
+   }
+
+   if (bpp != 3 && bpp != 4)
+      return 0;
+
+   // a = left (already reconstructed), b = up, c = up-left
+   a = stbi__png_load_pixel(cur - bpp, bpp);
+   switch (filter) {
+      case STBI__F_sub:
+      case STBI__F_paeth_first: // paeth(a,0,0) == a
+         for (; k < nk; k += bpp) {
+            a = _mm_add_epi8(stbi__png_load_pixel(raw + k, bpp), a);
+            stbi__png_store_pixel(cur + k, a, bpp);
+         }
+         return 1;
+
+      case STBI__F_avg:
+      case STBI__F_avg_first:
+         for (; k < nk; k += bpp) {
+            // pavgb rounds up, (a+b)>>1 rounds down
+            __m128i avg;
+            b = filter == STBI__F_avg ? stbi__png_load_pixel(prior + k, bpp) : zero;
+            avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+            a = _mm_add_epi8(stbi__png_load_pixel(raw + k, bpp), avg);
+            stbi__png_store_pixel(cur + k, a, bpp);
+         }
+         return 1;
+
+      case STBI__F_paeth:
+         c = stbi__png_load_pixel(prior - bpp, bpp);
+         for (; k < nk; k += bpp) {
+            __m128i a16, b16, c16, pa, pb, pc, smallest, nearest;
+            b = stbi__png_load_pixel(prior + k, bpp);
+            a16 = _mm_unpacklo_epi8(a, zero);
+            b16 = _mm_unpacklo_epi8(b, zero);
+            c16 = _mm_unpacklo_epi8(c, zero);
+            // p = a + b - c; pa = |p - a|, pb = |p - b|, pc = |p - c|
+            pa = _mm_abs_epi16(_mm_sub_epi16(b16, c16));
+            pb = _mm_abs_epi16(_mm_sub_epi16(a16, c16));
+            pc = _mm_abs_epi16(_mm_sub_epi16(_mm_add_epi16(a16, b16), _mm_add_epi16(c16, c16)));
+            // ties prefer a, then b, as in stbi__paeth
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            nearest = _mm_blendv_epi8(c16, b16, _mm_cmpeq_epi16(smallest, pb));
+            nearest = _mm_blendv_epi8(nearest, a16, _mm_cmpeq_epi16(smallest, pa));
+            a = _mm_add_epi8(stbi__png_load_pixel(raw + k, bpp), _mm_packus_epi16(nearest, nearest));
+            stbi__png_store_pixel(cur + k, a, bpp);
+            c = b;
+         }
+         return 1;
+   }
+   return 0;
+}
+#endif // STBI_AVX2
+
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
    int bytes = (depth == 16? 2 : 1);
@@ -4675,6 +4990,13 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          #define STBI__CASE(f) \
              case f:     \
                 for (k=0; k < nk; ++k)
+#ifdef STBI_AVX2
+         // [cpp-glfw] byte-wise "up" is valid for any depth; the others need whole 8-bit pixels
+         if (filter != STBI__F_none && depth >= 8 && (depth == 8 || filter == STBI__F_up) && stbi__avx2_available()
+             && stbi__png_unfilter_row_avx2(filter, cur, raw, prior, nk, filter_bytes)) {
+            // done
+         } else
+#endif
          switch (filter) {
             // "none" filter turns into a memcpy here; make that explicit.
             case STBI__F_none:         memcpy(cur, raw, nk); break;
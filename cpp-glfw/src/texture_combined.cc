@@ -1,36 +1,11 @@
-#include "stb_image/stb_image.h"
-#include "utils/file_path.h"
+#include "utils/gl_state.h"
 #include "utils/glfw_module.h"
-#include "utils/shader.h"
+#include "utils/shader_variants.h"
+#include "utils/texture_atlas.h"
 
-#include <filesystem>
-#include <iostream>
-
-const char* const VERTEXT_SHADER_SOURCE = R"(
-    #version 330 core
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec2 aTexCoord;
-    out vec2 TexCoord;
-
-    void main()
-    {
-       gl_Position = vec4(aPos, 1.0);
-       TexCoord = aTexCoord;
-    }
-)";
-
-const char* const FRAGMENT_SHADER_SOURCE = R"(
-    #version 330 core
-    out vec4 FragColor;
-    in vec2 TexCoord;
-    uniform sampler2D texture1;
-    uniform sampler2D texture2;
-
-    void main()
-    {
-        FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);
-    }
-)";
+// texture.frag 的特性位，对应 ShaderVariants 的 features
+constexpr uint32_t MIX_TEXTURE2 = 1u << 0;
+constexpr uint32_t ATLAS = 1u << 1;
 
 // clang-format off
 GLfloat vertices[] = {
@@ -47,72 +22,39 @@ GLuint indices[] = {
     1, 2, 3  // second triangle
 };
 
-int main()
+int main(int argc, char* argv[])
 {
-    auto module = utils::GlfwModule();
+    auto module = utils::GlfwModule(utils::ParseCommandLine(argc, argv));
     if (!module.InitializeContext())
     {
         return -1;
     }
-    utils::Shader shader{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
-
-    // tell stb_image.h to flip loaded texture's on the y-axis.
-    stbi_set_flip_vertically_on_load(true);
-
-    int width = 0;
-    int height = 0;
-    int channels = 0;
-    std::string image_path = utils::GetExecutableDir() + "/assets/container.jpeg";
-    unsigned char* image_data = stbi_load(image_path.c_str(), &width, &height, &channels, 0);
-    if (!image_data)
+    auto& gl_state = utils::GLStateCache::Current();
+    // 与其他纹理示例共用 texture.vert / texture.frag，打开 MIX_TEXTURE2 和 ATLAS 编译出从同一张图集混合两张图片的版本
+    utils::ShaderVariants shaders{module.GetAssetPath("shaders/texture.vert"),
+                                  module.GetAssetPath("shaders/texture.frag"), {"MIX_TEXTURE2", "ATLAS"}};
+    // 异步编译，和下面的图片解码重叠进行
+    utils::Shader& shader = shaders.Get(MIX_TEXTURE2 | ATLAS);
+
+    // 两张图片装进同一张图集，绘制时只绑定一个纹理单元。
+    // 优先使用构建时烘焙好的 .gltex（映射文件直接拷贝第 0 级，已经上下翻转），没有时同步解码源图片
+    // 与原来两张纹理时一样只用 GL_LINEAR 采样第 0 级：不需要 mipmap，截图也不取决于工作线程什么时候生成完
+    utils::TextureAtlas atlas{{.mipmaps = false}};
+    // 最后一个参数：解码源图片时上下翻转，对应 OpenGL 的纹理坐标（烘焙的版本已经翻转过）
+    int container = atlas.AddCookedOrFile(module.GetAssetPath("cooked/container.gltex"),
+                                          module.GetAssetPath("container.jpeg"), true);
+    // awesomeface.png 带 alpha 通道，图集统一使用 GL_RGBA8
+    int face = atlas.AddCookedOrFile(module.GetAssetPath("cooked/awesomeface.gltex"),
+                                     module.GetAssetPath("awesomeface.png"), true);
+    if (container < 0 || face < 0)
     {
-        std::cout << "ERROR: Load image failed: " << image_path << "\n";
         return -1;
     }
-
-    // texture 1
-    // ---------
-    GLuint texture1 = 0;
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    // 为当前绑定的纹理对象设置环绕、过滤方式
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // 加载并生成纹理
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(image_data);
-    image_data = nullptr;
-
-    image_path = utils::GetExecutableDir() + "/assets/awesomeface.png";
-    image_data = stbi_load(image_path.c_str(), &width, &height, &channels, 0);
-    if (!image_data)
-    {
-        std::cout << "ERROR: Load image failed: " << image_path << "\n";
-        return -1;
-    }
-
-    // texture 2
-    // ---------
-    GLuint texture2 = 0;
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    // 为当前绑定的纹理对象设置环绕、过滤方式
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // 加载并生成纹理
-    // note that the awesomeface.png has transparency and thus an alpha channel,
-    // so make sure to tell OpenGL the data type is of GL_RGBA
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(image_data);
-    image_data = nullptr;
+    atlas.Build();
+    utils::AtlasRegion const& region1 = atlas.Region(container);
+    utils::AtlasRegion const& region2 = atlas.Region(face);
+    // 两张图片都只有 512x512，一定在第一页
+    utils::TextureHandle texture = atlas.PageTexture(region1.page);
 
     GLuint vbo = 0;
     GLuint vao = 0;
@@ -121,12 +63,12 @@ int main()
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
+    gl_state.BindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    gl_state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    gl_state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)0);
@@ -136,8 +78,8 @@ int main()
 
     // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound
     // vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl_state.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl_state.BindVertexArray(0);
 
     // uncomment this call to draw in wireframe polygons.
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -150,24 +92,26 @@ int main()
     // -------------------------------------------------------------------------------------------
     shader.Use(); // don't forget to activate/use the shader before setting uniforms!
     shader.SetInt("texture1", 0);
-    shader.SetInt("texture2", 1);
+    shader.SetVec4("region1", glm::vec4(region1.u0, region1.v0, region1.u1, region1.v1));
+    shader.SetVec4("region2", glm::vec4(region2.u0, region2.v0, region2.u1, region2.v1));
 
     module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
-    module.RunMessageLoop([&shader, vao, texture1, texture2] {
-        // bind textures on corresponding texture units
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+    // 静态画面，只在窗口变化或输入时重绘
+    module.SetRedrawMode(utils::RedrawMode::OnDemand);
+    auto& gpu_timer = module.GetGpuTimer();
+    module.RunMessageLoop([&gl_state, &shader, &gpu_timer, vao, &texture] {
+        // bind the atlas page, both images are sampled from it
+        gl_state.BindTexture(0, GL_TEXTURE_2D, texture->Id());
 
         // render container
+        utils::GpuScope scope{gpu_timer, "draw container"};
         shader.Use();
-        glBindVertexArray(vao);
+        gl_state.BindVertexArray(vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     });
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    gl_state.DeleteVertexArrays(1, &vao);
+    gl_state.DeleteBuffers(1, &vbo);
 
     return 0;
 }
\ No newline at end of file
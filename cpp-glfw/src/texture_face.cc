@@ -1,35 +1,10 @@
-#include "stb_image/stb_image.h"
-#include "utils/file_path.h"
+#include "utils/gl_state.h"
 #include "utils/glfw_module.h"
-#include "utils/shader.h"
+#include "utils/shader_variants.h"
+#include "utils/textures.h"
 
-#include <filesystem>
-#include <iostream>
-
-const char* const VERTEXT_SHADER_SOURCE = R"(
-    #version 330 core
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec2 aTexCoord;
-    out vec2 TexCoord;
-
-    void main()
-    {
-       gl_Position = vec4(aPos, 1.0);
-       TexCoord = aTexCoord;
-    }
-)";
-
-const char* const FRAGMENT_SHADER_SOURCE = R"(
-    #version 330 core
-    out vec4 FragColor;
-    in vec2 TexCoord;
-    uniform sampler2D ourTexture;
-
-    void main()
-    {
-        FragColor = texture(ourTexture, vec2(1.0 - TexCoord.x, TexCoord.y));
-    }
-)";
+// texture.frag 的特性位，对应 ShaderVariants 的 features
+constexpr uint32_t FLIP_X = 1u << 0;
 
 // clang-format off
 GLfloat vertices[] = {
@@ -46,43 +21,31 @@ GLuint indices[] = {
     1, 2, 3  // second triangle
 };
 
-int main()
+int main(int argc, char* argv[])
 {
-    auto module = utils::GlfwModule();
+    auto module = utils::GlfwModule(utils::ParseCommandLine(argc, argv));
     if (!module.InitializeContext())
     {
         return -1;
     }
-    utils::Shader shader{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
-
-    // tell stb_image.h to flip loaded texture's on the y-axis.
-    stbi_set_flip_vertically_on_load(true);
-
-    int width = 0;
-    int height = 0;
-    int channels = 0;
-    std::string image_path = utils::GetExecutableDir() + "/assets/awesomeface.png";
-    unsigned char* image_data = stbi_load(image_path.c_str(), &width, &height, &channels, 0);
-    if (!image_data)
-    {
-        std::cout << "ERROR: Load image failed: " << image_path << "\n";
-        return -1;
-    }
-
-    GLuint texture = 0;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // 为当前绑定的纹理对象设置环绕、过滤方式
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // 加载并生成纹理
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(image_data);
-    image_data = nullptr;
+    auto& gl_state = utils::GLStateCache::Current();
+    // 与其他纹理示例共用 texture.vert / texture.frag，打开 FLIP_X 编译出水平镜像的版本
+    utils::ShaderVariants shaders{module.GetAssetPath("shaders/texture.vert"),
+                                  module.GetAssetPath("shaders/texture.frag"), {"FLIP_X"}};
+    // 异步编译，和下面的图片解码重叠进行
+    utils::Shader& shader = shaders.Get(FLIP_X);
+
+    // 优先使用构建时烘焙好的 .gltex；没有时在工作线程解码，消息循环里通过 PBO 上传，
+    // 加载完成之前绘制透明的占位纹理
+    utils::TextureManager textures;
+    textures.SetStreamingCallback([&module] { module.Invalidate(); });
+    // flip_vertically：解码时上下翻转，对应 OpenGL 的纹理坐标（烘焙的版本已经翻转过）。
+    // 没有烘焙版本时在工作线程生成 mipmap：awesomeface.png 透明处的颜色是无意义的，预乘 alpha 后滤波才不会在边缘渗出
+    utils::TextureOptions options{
+        .flip_vertically = true,
+        .mip_options = {.filter = utils::MipFilter::Kaiser, .srgb = true, .premultiplied_alpha = true}};
+    utils::TextureHandle texture = textures.LoadCookedOrAsync(module.GetAssetPath("cooked/awesomeface.gltex"),
+                                                              module.GetAssetPath("awesomeface.png"), options);
 
     GLuint vbo = 0;
     GLuint vao = 0;
@@ -91,12 +54,12 @@ int main()
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
+    gl_state.BindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    gl_state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    gl_state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)0);
@@ -106,26 +69,33 @@ int main()
 
     // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound
     // vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl_state.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl_state.BindVertexArray(0);
 
     // uncomment this call to draw in wireframe polygons.
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    glEnable(GL_BLEND);                                //开混合模式贴图
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // 指定混合模式算法
+    gl_state.SetEnabled(GL_BLEND, true);                      // 开混合模式贴图
+    gl_state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // 指定混合模式算法
 
     module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
-    module.RunMessageLoop([&shader, vao, texture] {
+    // 静态画面，只在窗口变化或输入时重绘
+    module.SetRedrawMode(utils::RedrawMode::OnDemand);
+    module.RunMessageLoop([&module, &gl_state, &textures, &shader, vao, &texture] {
+        if (textures.Update())
+        {
+            module.Invalidate();
+        }
+
         shader.Use();
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glBindVertexArray(vao);
+        gl_state.BindTexture(0, GL_TEXTURE_2D, texture->Id());
+        gl_state.BindVertexArray(vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         // glBindVertexArray(0); // no need to unbind it every time
     });
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    gl_state.DeleteVertexArrays(1, &vao);
+    gl_state.DeleteBuffers(1, &vbo);
 
     return 0;
 }
\ No newline at end of file
@@ -1,35 +1,6 @@
-#include "stb_image/stb_image.h"
-#include "utils/file_path.h"
+#include "utils/asset_reloader.h"
+#include "utils/gl_state.h"
 #include "utils/glfw_module.h"
-#include "utils/shader.h"
-
-#include <filesystem>
-#include <iostream>
-
-const char* const VERTEXT_SHADER_SOURCE = R"(
-    #version 330 core
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec2 aTexCoord;
-    out vec2 TexCoord;
-
-    void main()
-    {
-       gl_Position = vec4(aPos, 1.0);
-       TexCoord = aTexCoord;
-    }
-)";
-
-const char* const FRAGMENT_SHADER_SOURCE = R"(
-    #version 330 core
-    out vec4 FragColor;
-    in vec2 TexCoord;
-    uniform sampler2D ourTexture;
-
-    void main()
-    {
-        FragColor = texture(ourTexture, TexCoord);
-    }
-)";
 
 // clang-format off
 GLfloat vertices[] = {
@@ -46,29 +17,23 @@ GLuint indices[] = {
     1, 2, 3  // second triangle
 };
 
-int main()
+int main(int argc, char* argv[])
 {
-    auto module = utils::GlfwModule();
+    auto module = utils::GlfwModule(utils::ParseCommandLine(argc, argv));
     if (!module.InitializeContext())
     {
         return -1;
     }
-    utils::Shader shader{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
-
-    int width = 0;
-    int height = 0;
-    int channels = 0;
-    std::string image_path = utils::GetExecutableDir() + "/assets/container.jpeg";
-    unsigned char* image_data = stbi_load(image_path.c_str(), &width, &height, &channels, 0);
-    if (!image_data)
-    {
-        std::cout << "ERROR: Load image failed: " << image_path << "\n";
-        return -1;
-    }
+    auto& gl_state = utils::GLStateCache::Current();
+    // shader 和图片都从资源目录加载，--hot-reload 时修改文件会自动重新加载
+    utils::AssetReloader assets;
+    // 异步编译，和下面的图片解码重叠进行
+    auto& shader = assets.AddShader(module.GetAssetPath("shaders/texture.vert"),
+                                    module.GetAssetPath("shaders/texture.frag"));
 
     GLuint texture = 0;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    gl_state.BindTextureForUpdate(0, GL_TEXTURE_2D, texture);
     // 为当前绑定的纹理对象设置环绕、过滤方式
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -76,10 +41,10 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     // 加载并生成纹理
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(image_data);
-    image_data = nullptr;
+    if (!assets.AddTexture(texture, module.GetAssetPath("container.jpeg")))
+    {
+        return -1;
+    }
 
     GLuint vbo = 0;
     GLuint vao = 0;
@@ -88,12 +53,12 @@ int main()
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
+    gl_state.BindVertexArray(vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    gl_state.BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    gl_state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)0);
@@ -103,23 +68,47 @@ int main()
 
     // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound
     // vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl_state.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl_state.BindVertexArray(0);
 
     // uncomment this call to draw in wireframe polygons.
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
-    module.RunMessageLoop([&shader, vao, texture] {
-        shader.Use();
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glBindVertexArray(vao);
+    // 静态画面，只在窗口变化或输入时重绘
+    module.SetRedrawMode(utils::RedrawMode::OnDemand);
+    if (module.IsHotReloadEnabled())
+    {
+        assets.StartWatching([&module] { module.Invalidate(); });
+    }
+    // headless / 截图时等待编译完成，否则截到的帧取决于驱动编译得有多快
+    if (module.IsHeadless() || module.IsCapturing())
+    {
+        shader.Get().Wait();
+    }
+    module.RunMessageLoop([&module, &assets, &gl_state, &shader, vao, texture] {
+        // 帧边界：换上重新编译好的 shader 和重新解码的纹理
+        bool building = assets.ApplyPending();
+        if (building)
+        {
+            module.Invalidate();
+        }
+
+        // 编译完成之前只清屏，不阻塞消息循环
+        if (!shader.IsReady())
+        {
+            return;
+        }
+
+        shader.Get().Use();
+        gl_state.BindTexture(0, GL_TEXTURE_2D, texture);
+        gl_state.BindVertexArray(vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         // glBindVertexArray(0); // no need to unbind it every time
     });
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    gl_state.DeleteVertexArrays(1, &vao);
+    gl_state.DeleteBuffers(1, &vbo);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+// 图片解码吞吐量测试
+//
+// 用法: decode-bench [image...] [--seconds S]
+// 不指定图片时测试可执行文件旁 assets 目录下的所有 PNG/JPEG。每张图片分别按原始通道数、3 通道、4 通道解码，
+// CPU 支持 AVX2 时再关闭 AVX2 内核测一遍作为对比。文件预先读入内存，只计解码时间。
+// 每个组合输出一行 JSON，mb_per_s 按解码输出的像素字节数计算。
+
+#include "stb_image/stb_image.h"
+#include "utils/file_path.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr double DEFAULT_SECONDS = 0.5;
+constexpr int MIN_ITERATIONS = 3;
+
+std::string FormatOf(std::filesystem::path const& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".png")
+    {
+        return "png";
+    }
+    if (extension == ".jpg" || extension == ".jpeg")
+    {
+        return "jpeg";
+    }
+    return "";
+}
+
+std::vector<std::string> FindAssetImages()
+{
+    std::vector<std::string> images;
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::directory_iterator(utils::GetExecutableDir() + "/assets", ec))
+    {
+        if (entry.is_regular_file() && !FormatOf(entry.path()).empty())
+        {
+            images.push_back(entry.path().string());
+        }
+    }
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+// 返回解码失败时为 false
+bool Bench(std::string const& path, std::vector<uint8_t> const& file_data, int channels, bool avx2, double seconds)
+{
+    using Clock = std::chrono::steady_clock;
+    stbi_set_avx2_enabled(avx2);
+
+    int width = 0;
+    int height = 0;
+    int file_channels = 0;
+    int iterations = 0;
+    Clock::duration total{0};
+    while (iterations < MIN_ITERATIONS || std::chrono::duration<double>(total).count() < seconds)
+    {
+        Clock::time_point start = Clock::now();
+        stbi_uc* pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width,
+                                                &height, &file_channels, channels);
+        total += Clock::now() - start;
+        if (!pixels)
+        {
+            std::cout << "ERROR: Load image failed: " << path << " (" << stbi_failure_reason() << ")\n";
+            return false;
+        }
+        stbi_image_free(pixels);
+        ++iterations;
+    }
+
+    int out_channels = channels ? channels : file_channels;
+    double total_s = std::chrono::duration<double>(total).count();
+    double output_mb = static_cast<double>(width) * height * out_channels / (1024.0 * 1024.0);
+    std::cout << "{\"decode\":{\"file\":\"" << std::filesystem::path(path).filename().string() << "\""
+              << ",\"format\":\"" << FormatOf(path) << "\""
+              << ",\"width\":" << width << ",\"height\":" << height
+              << ",\"channels\":" << out_channels << ",\"file_channels\":" << file_channels
+              << ",\"kernels\":\"" << (avx2 ? "avx2" : "baseline") << "\""
+              << ",\"iterations\":" << iterations
+              << ",\"ms\":" << total_s * 1000.0 / iterations
+              << ",\"mb_per_s\":" << output_mb * iterations / total_s << "}}\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> images;
+    double seconds = DEFAULT_SECONDS;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+        {
+            seconds = atof(argv[++i]);
+        }
+        else
+        {
+            images.push_back(argv[i]);
+        }
+    }
+    if (images.empty())
+    {
+        images = FindAssetImages();
+    }
+    if (images.empty())
+    {
+        std::cout << "usage: decode-bench [image...] [--seconds S]\n";
+        return 2;
+    }
+
+    stbi_set_avx2_enabled(1);
+    bool has_avx2 = stbi_avx2_active() != 0;
+
+    int failures = 0;
+    for (std::string const& path : images)
+    {
+        std::vector<uint8_t> file_data;
+        {
+            std::ifstream in(path, std::ios::binary);
+            file_data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        // 0 表示按文件本身的通道数
+        for (int channels : {0, 3, 4})
+        {
+            if (has_avx2 && !Bench(path, file_data, channels, true, seconds))
+            {
+                ++failures;
+                break;
+            }
+            if (!Bench(path, file_data, channels, false, seconds))
+            {
+                ++failures;
+                break;
+            }
+        }
+    }
+    stbi_set_avx2_enabled(1);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// 比较截图和参考图片，输出 PSNR 和最大误差
+//
+// 用法: image-diff <actual> <reference> [--min-psnr DB] [--max-error N]
+// 两张图片都通过 stb_image 读取（PNG/JPEG/PNM 等），统一转换成 RGB 后比较。
+// 结果以一行 JSON 输出，超出阈值时返回 1，读取失败或尺寸不一致时返回 2。
+
+#include "stb_image/stb_image.h"
+#include "utils/image_diff.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+
+constexpr double DEFAULT_MIN_PSNR = 40.0;
+constexpr int DEFAULT_MAX_ERROR = 16;
+
+struct StbiDeleter
+{
+    void operator()(unsigned char* data) const
+    {
+        stbi_image_free(data);
+    }
+};
+
+using StbiPixels = std::unique_ptr<unsigned char, StbiDeleter>;
+
+StbiPixels LoadRgb(const char* path, int& width, int& height)
+{
+    int channels = 0;
+    StbiPixels pixels{stbi_load(path, &width, &height, &channels, 3)};
+    if (!pixels)
+    {
+        std::cout << "ERROR: Load image failed: " << path << "\n";
+    }
+    return pixels;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: image-diff <actual> <reference> [--min-psnr DB] [--max-error N]\n";
+        return 2;
+    }
+
+    double min_psnr = DEFAULT_MIN_PSNR;
+    int max_error = DEFAULT_MAX_ERROR;
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--min-psnr") == 0)
+        {
+            min_psnr = atof(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--max-error") == 0)
+        {
+            max_error = atoi(argv[i + 1]);
+        }
+    }
+
+    int actual_width = 0;
+    int actual_height = 0;
+    int reference_width = 0;
+    int reference_height = 0;
+    StbiPixels actual = LoadRgb(argv[1], actual_width, actual_height);
+    StbiPixels reference = LoadRgb(argv[2], reference_width, reference_height);
+    if (!actual || !reference)
+    {
+        return 2;
+    }
+
+    if (actual_width != reference_width || actual_height != reference_height)
+    {
+        std::cout << "ERROR: Image size mismatch: " << actual_width << "x" << actual_height << " vs "
+                  << reference_width << "x" << reference_height << "\n";
+        return 2;
+    }
+
+    size_t count = static_cast<size_t>(actual_width) * actual_height * 3;
+    utils::ImageDiff diff = utils::DiffPixels(actual.get(), reference.get(), count);
+    double psnr = diff.Psnr();
+    bool pass = psnr >= min_psnr && static_cast<int>(diff.max_error) <= max_error;
+
+    // JSON 没有 inf，完全一致时输出 null
+    std::cout << "{\"image\":\"" << argv[1] << "\",\"psnr\":";
+    if (std::isinf(psnr))
+    {
+        std::cout << "null";
+    }
+    else
+    {
+        std::cout << psnr;
+    }
+    std::cout << ",\"max_error\":" << diff.max_error << ",\"pass\":" << (pass ? "true" : "false") << "}\n";
+
+    return pass ? 0 : 1;
+}
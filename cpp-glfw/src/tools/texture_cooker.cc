@@ -0,0 +1,196 @@
+// 把 PNG/JPEG 等图片烘焙成 .gltex（格式见 utils/cooked_texture.h）
+//
+// 用法: texture-cooker <input> <output> [--flip] [--no-mips] [--filter box|kaiser] [--srgb] [--premultiplied-alpha]
+//                      [--compress bc1|bc3|auto]
+// 解码、上下翻转、三通道扩展为 RGBA 以及生成完整的 mipmap 链（见 utils/mip_generator.h）都在这里完成，
+// 指定 --compress 时再把各级压缩成 S3TC 块（auto 按有无 alpha 选择 BC3 / BC1，见 utils/block_compression.h），
+// 运行时只需要映射文件并逐级上传。构建时由 cook_assets 目标对 assets 下的图片调用。
+
+#include "stb_image/stb_image.h"
+#include "utils/block_compression.h"
+#include "utils/cooked_texture.h"
+#include "utils/hash.h"
+#include "utils/mip_generator.h"
+#include "utils/thread_pool.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 三通道的行宽不是 4 的倍数，GPU 也大多没有原生的 RGB8 格式，烘焙时补上不透明的 alpha
+std::vector<uint8_t> ExpandRgbToRgba(const uint8_t* rgb, size_t pixel_count)
+{
+    std::vector<uint8_t> rgba(pixel_count * 4);
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+    return rgba;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    bool flip = false;
+    bool mipmaps = true;
+    utils::MipOptions mip_options;
+    // 空表示不压缩；auto 在解码后按通道数决定
+    std::optional<utils::BlockFormat> compression;
+    bool compress_auto = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--flip") == 0)
+        {
+            flip = true;
+        }
+        else if (strcmp(argv[i], "--no-mips") == 0)
+        {
+            mipmaps = false;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "box") == 0)
+            {
+                mip_options.filter = utils::MipFilter::Box;
+            }
+            else if (strcmp(argv[i], "kaiser") == 0)
+            {
+                mip_options.filter = utils::MipFilter::Kaiser;
+            }
+            else
+            {
+                std::cout << "ERROR: Unknown filter: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--srgb") == 0)
+        {
+            mip_options.srgb = true;
+        }
+        else if (strcmp(argv[i], "--premultiplied-alpha") == 0)
+        {
+            mip_options.premultiplied_alpha = true;
+        }
+        else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "bc1") == 0)
+            {
+                compression = utils::BlockFormat::BC1;
+            }
+            else if (strcmp(argv[i], "bc3") == 0)
+            {
+                compression = utils::BlockFormat::BC3;
+            }
+            else if (strcmp(argv[i], "auto") == 0)
+            {
+                compress_auto = true;
+            }
+            else
+            {
+                std::cout << "ERROR: Unknown compression: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2)
+    {
+        std::cout << "usage: texture-cooker <input> <output> [--flip] [--no-mips] [--filter box|kaiser] [--srgb] "
+                     "[--premultiplied-alpha] [--compress bc1|bc3|auto]\n";
+        return 2;
+    }
+
+    std::string const& input = paths[0];
+    std::string const& output = paths[1];
+    std::vector<uint8_t> file_data;
+    {
+        std::ifstream in(input, std::ios::binary);
+        file_data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_set_flip_vertically_on_load(flip);
+    uint8_t* pixels = file_data.empty() ? nullptr
+                                        : stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()),
+                                                                &width, &height, &channels, 0);
+    if (!pixels)
+    {
+        std::cout << "ERROR: Load image failed: " << input << "\n";
+        return 1;
+    }
+
+    std::vector<utils::cooked_texture::LevelImage> levels(1);
+    levels[0].width = width;
+    levels[0].height = height;
+    size_t pixel_count = static_cast<size_t>(width) * height;
+    if (compress_auto)
+    {
+        compression = utils::BlockFormatForChannels(channels);
+    }
+    if (channels == 3)
+    {
+        levels[0].pixels = ExpandRgbToRgba(pixels, pixel_count);
+        channels = 4;
+    }
+    else
+    {
+        levels[0].pixels.assign(pixels, pixels + pixel_count * channels);
+    }
+    stbi_image_free(pixels);
+
+    if (mipmaps)
+    {
+        for (utils::MipLevel& mip : utils::GenerateMipChain(levels[0].pixels.data(), width, height, channels,
+                                                            mip_options))
+        {
+            levels.push_back({mip.width, mip.height, std::move(mip.pixels)});
+        }
+    }
+
+    uint32_t format = 0;
+    if (compression)
+    {
+        // 每一级按块行分给所有核并行压缩
+        utils::ThreadPool pool(std::thread::hardware_concurrency());
+        for (utils::cooked_texture::LevelImage& level : levels)
+        {
+            level.pixels = utils::CompressImage(level.pixels.data(), level.width, level.height, channels, *compression,
+                                                &pool);
+        }
+        format = utils::BlockFormatInternalFormat(*compression);
+        channels = *compression == utils::BlockFormat::BC1 ? 3 : 4;
+    }
+
+    uint32_t flags = flip ? utils::cooked_texture::FLIPPED_VERTICALLY : 0;
+    uint64_t content_hash = utils::Fnv1a64(file_data.data(), file_data.size());
+    std::string error;
+    if (!utils::cooked_texture::Write(output, channels, format, flags, content_hash, levels, &error))
+    {
+        std::cout << "ERROR: " << error << "\n";
+        return 1;
+    }
+
+    std::cout << input << " -> " << output << " (" << width << "x" << height << ", " << channels << " channels, "
+              << levels.size() << " levels" << (compression ? ", compressed" : "") << ")\n";
+    return 0;
+}
@@ -0,0 +1,129 @@
+// 把大图切成 .gltiles 分块金字塔（格式见 utils/tiled_image.h），由 deep-zoom 示例查看
+//
+// 用法: tile-pyramid <input> <output> [--tile-size N] [--border N] [--filter box|kaiser] [--srgb]
+//                    [--premultiplied-alpha]
+// 二进制 PGM / PPM（P5 / P6）直接映射文件逐行读取，可以处理几十亿像素、内存放不下的扫描图；
+// 其他格式用 stb_image 整张解码，受内存和 stb_image 的尺寸上限约束。
+// 每一级从上一级 2:1 缩小（见 utils/mip_generator.h），直到一块瓦片能放下整级。
+
+#include "stb_image/stb_image.h"
+#include "utils/mapped_file.h"
+#include "utils/thread_pool.h"
+#include "utils/tiled_image.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    utils::tiled_image::BuildOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc)
+        {
+            options.tile_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--border") == 0 && i + 1 < argc)
+        {
+            options.border = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "box") == 0)
+            {
+                options.mip_options.filter = utils::MipFilter::Box;
+            }
+            else if (strcmp(argv[i], "kaiser") == 0)
+            {
+                options.mip_options.filter = utils::MipFilter::Kaiser;
+            }
+            else
+            {
+                std::cout << "ERROR: Unknown filter: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--srgb") == 0)
+        {
+            options.mip_options.srgb = true;
+        }
+        else if (strcmp(argv[i], "--premultiplied-alpha") == 0)
+        {
+            options.mip_options.premultiplied_alpha = true;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2)
+    {
+        std::cout << "usage: tile-pyramid <input> <output> [--tile-size N] [--border N] [--filter box|kaiser] "
+                     "[--srgb] [--premultiplied-alpha]\n";
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    utils::tiled_image::SourceImage source;
+    utils::MappedFile file;
+    std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> decoded(nullptr, stbi_image_free);
+    std::string error;
+    if (!file.Open(paths[0]))
+    {
+        std::cout << "ERROR: Cannot open " << paths[0] << "\n";
+        return 1;
+    }
+    if (!utils::tiled_image::ParsePnm(file.Data(), file.Size(), source))
+    {
+        if (file.Size() > INT32_MAX)
+        {
+            std::cout << "ERROR: " << paths[0] << " is too large to decode, convert it to PGM / PPM first\n";
+            return 1;
+        }
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        decoded.reset(
+            stbi_load_from_memory(file.Data(), static_cast<int>(file.Size()), &width, &height, &channels, 0));
+        if (!decoded)
+        {
+            std::cout << "ERROR: Failed to decode " << paths[0] << " (" << stbi_failure_reason() << ")\n";
+            return 1;
+        }
+        file.Close();
+        source = {decoded.get(), width, height, channels};
+    }
+
+    utils::ThreadPool pool;
+    if (!utils::tiled_image::Write(paths[1], source, options, &pool, &error))
+    {
+        std::cout << "ERROR: " << error << "\n";
+        return 1;
+    }
+
+    // 读回校验（只读文件头和级别表，不预读瓦片），顺便统计瓦片数
+    utils::MappedFile output;
+    utils::tiled_image::View view;
+    if (!output.Open(paths[1], utils::MappedAccess::Random) ||
+        !utils::tiled_image::Parse(output.Data(), output.Size(), view, &error))
+    {
+        std::cout << "ERROR: Invalid output " << paths[1] << " (" << error << ")\n";
+        return 1;
+    }
+    size_t tiles = 0;
+    for (uint32_t level = 0; level < view.header->level_count; ++level)
+    {
+        tiles += static_cast<size_t>(view.levels[level].tiles_x) * view.levels[level].tiles_y;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << paths[0] << " -> " << paths[1] << " (" << source.width << "x" << source.height << ", "
+              << view.header->level_count << " levels, " << tiles << " tiles, " << elapsed << " s)\n";
+    return 0;
+}
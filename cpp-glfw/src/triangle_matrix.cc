@@ -1,14 +1,20 @@
+#include "utils/gl_state.h"
 #include "utils/glfw_module.h"
 #include "utils/shader.h"
+#include "utils/std140.h"
+#include "utils/uniform_ring.h"
 
+#include <cstddef>
 #include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 
 const char* const VERTEXT_SHADER_SOURCE = R"(
     #version 330 core
     layout (location = 0) in vec3 position;
-    uniform mat4 matrix;
+    layout (std140) uniform Transform
+    {
+        mat4 matrix;
+    };
 
     void main()
     {
@@ -26,65 +32,110 @@ const char* const FRAGMENT_SHADER_SOURCE = R"(
     }
 )";
 
+// 与 shader 中的 Transform block 对应
+struct TransformBlock
+{
+    glm::mat4 matrix;
+};
+static_assert(utils::std140::CheckLayout<glm::mat4>({offsetof(TransformBlock, matrix)}, sizeof(TransformBlock)));
+
+constexpr GLuint TRANSFORM_BINDING = 0;
+
 GLfloat vertices[] = {
     -0.5f, -0.5f, 0.0f, // left
     0.5f,  -0.5f, 0.0f, // right
     0.0f,  0.5f,  0.0f  // top
 };
 
-int main()
+class TriangleMatrixApp
 {
-    auto module = utils::GlfwModule();
-    if (!module.InitializeContext())
+public:
+    bool Init()
     {
-        return -1;
-    }
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+        // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex
+        // attributes(s).
+        gl_state_.BindVertexArray(vao_);
 
-    utils::Shader shader{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    GLuint vbo = 0;
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-    glBindVertexArray(vao);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's
+        // bound vertex buffer object so afterwards we can safely unbind
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, 0);
+        gl_state_.BindVertexArray(0);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
+        // uncomment this call to draw in wireframe polygons.
+        // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound
-    // vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // uncomment this call to draw in wireframe polygons.
-    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glm::mat4x4 matrix = glm::mat4x4(1.0f);
+        if (!shader_.BindUniformBlock("Transform", TRANSFORM_BINDING))
+        {
+            utils::ShowErrorMessage("uniform block Transform not found");
+            return false;
+        }
 
-    GLfloat offset = -0.5f;
-    GLfloat step = 0.005f;
+        // 每帧的变换矩阵写进 uniform ring，不再逐个 glUniform*
+        return uniforms_.Create(sizeof(TransformBlock));
+    }
 
-    module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
-    module.RunMessageLoop([&shader, vao, &offset, &step, &matrix] {
-        offset += step;
-        if (offset > 0.5f || offset < -0.5f)
+    // 以固定步长推进，移动速度与帧率无关
+    void Update(double dt)
+    {
+        previous_offset_ = offset_;
+        offset_ += speed_ * static_cast<GLfloat>(dt);
+        if (offset_ > 0.5f || offset_ < -0.5f)
         {
-            step = -step;
+            speed_ = -speed_;
         }
-        matrix[3][0] = offset;
+    }
 
-        shader.Use();
-        glUniformMatrix4fv(shader.GetUniformLocation("matrix"), 1, GL_FALSE, glm::value_ptr(matrix));
-        glBindVertexArray(vao);
+    void Render(float alpha)
+    {
+        matrix_[3][0] = previous_offset_ + (offset_ - previous_offset_) * alpha;
+
+        uniforms_.BeginFrame();
+        uniforms_.Bind(TRANSFORM_BINDING, uniforms_.Push(TransformBlock{matrix_}));
+
+        shader_.Use();
+        gl_state_.BindVertexArray(vao_);
         glDrawArrays(GL_TRIANGLES, 0, 3);
         // glBindVertexArray(0); // no need to unbind it every time
-    });
+        uniforms_.EndFrame();
+    }
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    void Shutdown()
+    {
+        gl_state_.DeleteVertexArrays(1, &vao_);
+        gl_state_.DeleteBuffers(1, &vbo_);
+        uniforms_.Release();
+    }
+
+private:
+    utils::Shader shader_{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
+    utils::GLStateCache& gl_state_ = utils::GLStateCache::Current();
+    utils::UniformRing uniforms_;
+    GLuint vbo_ = 0;
+    GLuint vao_ = 0;
+    GLfloat offset_ = -0.5f;
+    GLfloat previous_offset_ = -0.5f;
+    // 每秒移动的距离（原来是每帧 0.005，按 60 帧折算）
+    GLfloat speed_ = 0.3f;
+    glm::mat4x4 matrix_ = glm::mat4x4(1.0f);
+};
 
-    return 0;
-}
\ No newline at end of file
+int main(int argc, char* argv[])
+{
+    auto module = utils::GlfwModule(utils::ParseCommandLine(argc, argv));
+    if (!module.InitializeContext())
+    {
+        return -1;
+    }
+
+    TriangleMatrixApp app;
+    module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
+    return module.Run(app) ? 0 : -1;
+}
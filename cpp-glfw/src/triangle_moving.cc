@@ -1,3 +1,4 @@
+#include "utils/gl_state.h"
 #include "utils/glfw_module.h"
 #include "utils/shader.h"
 
@@ -28,57 +29,79 @@ GLfloat vertices[] = {
     0.0f,  0.5f,  0.0f  // top
 };
 
-int main()
+class TriangleMovingApp
 {
-    auto module = utils::GlfwModule();
-    if (!module.InitializeContext())
+public:
+    bool Init()
     {
-        return -1;
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+        // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex
+        // attributes(s).
+        gl_state_.BindVertexArray(vao_);
+
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's
+        // bound vertex buffer object so afterwards we can safely unbind
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, 0);
+        gl_state_.BindVertexArray(0);
+
+        // uncomment this call to draw in wireframe polygons.
+        // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        return true;
     }
 
-    utils::Shader shader{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
-
-    GLuint vbo = 0;
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-    glBindVertexArray(vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound
-    // vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // uncomment this call to draw in wireframe polygons.
-    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-    GLfloat offset = -0.5f;
-    GLfloat step = 0.005f;
-
-    module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
-    module.RunMessageLoop([&shader, vao, &offset, &step] {
-        offset += step;
-        if (offset > 0.5f || offset < -0.5f)
+    // 以固定步长推进，移动速度与帧率无关
+    void Update(double dt)
+    {
+        previous_offset_ = offset_;
+        offset_ += speed_ * static_cast<GLfloat>(dt);
+        if (offset_ > 0.5f || offset_ < -0.5f)
         {
-            step = -step;
+            speed_ = -speed_;
         }
+    }
 
-        shader.Use();
-        shader.SetFloat("offset", offset);
-        glBindVertexArray(vao);
+    void Render(float alpha)
+    {
+        shader_.Use();
+        shader_.SetFloat("offset", previous_offset_ + (offset_ - previous_offset_) * alpha);
+        gl_state_.BindVertexArray(vao_);
         glDrawArrays(GL_TRIANGLES, 0, 3);
         // glBindVertexArray(0); // no need to unbind it every time
-    });
+    }
+
+    void Shutdown()
+    {
+        gl_state_.DeleteVertexArrays(1, &vao_);
+        gl_state_.DeleteBuffers(1, &vbo_);
+    }
+
+private:
+    utils::Shader shader_{VERTEXT_SHADER_SOURCE, FRAGMENT_SHADER_SOURCE};
+    utils::GLStateCache& gl_state_ = utils::GLStateCache::Current();
+    GLuint vbo_ = 0;
+    GLuint vao_ = 0;
+    GLfloat offset_ = -0.5f;
+    GLfloat previous_offset_ = -0.5f;
+    // 每秒移动的距离（原来是每帧 0.005，按 60 帧折算）
+    GLfloat speed_ = 0.3f;
+};
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+int main(int argc, char* argv[])
+{
+    auto module = utils::GlfwModule(utils::ParseCommandLine(argc, argv));
+    if (!module.InitializeContext())
+    {
+        return -1;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    TriangleMovingApp app;
+    module.SetBackgroundColor(0.2f, 0.3f, 0.3f);
+    return module.Run(app) ? 0 : -1;
+}
@@ -0,0 +1,226 @@
+#include "asset_reloader.h"
+#include "profiler.h"
+#include "stb_image/stb_image.h"
+#include "textures.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#define ASSERT assert
+
+namespace utils {
+
+namespace {
+
+// 展开两个阶段的 #include 并加上阶段宏，files 为读过的所有文件
+bool LoadShaderStages(std::string const& vertex_path, std::string const& fragment_path, std::string& vertex_text,
+                      std::string& fragment_text, std::vector<std::string>& files)
+{
+    ShaderSource vertex_source;
+    ShaderSource fragment_source;
+    std::string error;
+    if (!LoadShaderSource(vertex_path, {}, vertex_source, &error) ||
+        !LoadShaderSource(fragment_path, {}, fragment_source, &error))
+    {
+        std::cout << "ERROR::SHADER::PREPROCESS_FAILED\n" << error << "\n";
+        return false;
+    }
+
+    vertex_text = InjectDefines(vertex_source.text, "VERTEX_SHADER", {}, 0);
+    fragment_text = InjectDefines(fragment_source.text, "FRAGMENT_SHADER", {}, 0);
+    files = std::move(vertex_source.files);
+    for (std::string& file : fragment_source.files)
+    {
+        if (std::find(files.begin(), files.end(), file) == files.end())
+        {
+            files.push_back(std::move(file));
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+AssetReloader::~AssetReloader()
+{
+    watcher_.Stop();
+}
+
+ReloadableShader& AssetReloader::AddShader(std::string const& vertex_path, std::string const& fragment_path,
+                                           std::function<void(Shader&)> on_load)
+{
+    ASSERT(!watcher_.IsRunning());
+
+    std::string vertex_text;
+    std::string fragment_text;
+    auto shader = std::make_unique<ReloadableShader>();
+    if (!LoadShaderStages(vertex_path, fragment_path, vertex_text, fragment_text, shader->files_))
+    {
+        // 文件修好之后仍然可以热重载
+        shader->files_ = {vertex_path, fragment_path};
+    }
+
+    shader->vertex_path_ = vertex_path;
+    shader->fragment_path_ = fragment_path;
+    shader->on_load_ = std::move(on_load);
+    shader->current_ = std::make_unique<Shader>(vertex_text.c_str(), fragment_text.c_str(), ShaderBuild::Async);
+    for (std::string const& file : shader->files_)
+    {
+        watcher_.Watch(file);
+    }
+
+    shaders_.push_back(std::move(shader));
+    return *shaders_.back();
+}
+
+bool AssetReloader::AddTexture(GLuint texture, std::string const& path, bool flip_vertically)
+{
+    ASSERT(!watcher_.IsRunning());
+
+    TextureAsset asset{texture, path, flip_vertically};
+    PendingTexture decoded;
+    if (!DecodeTexture(asset, decoded))
+    {
+        return false;
+    }
+
+    UploadTexture2D(texture, decoded.width, decoded.height, decoded.channels, decoded.pixels.get());
+    watcher_.Watch(path);
+    textures_.push_back(std::move(asset));
+    return true;
+}
+
+bool AssetReloader::StartWatching(std::function<void()> on_change)
+{
+    on_change_ = std::move(on_change);
+    return watcher_.Start([this](std::string const& path) { OnFileChanged(path); });
+}
+
+void AssetReloader::OnFileChanged(std::string const& path)
+{
+    PROFILE_ZONE("AssetReloader::OnFileChanged");
+    for (auto& shader : shaders_)
+    {
+        if (std::find(shader->files_.begin(), shader->files_.end(), path) == shader->files_.end())
+        {
+            continue;
+        }
+
+        PendingShader pending;
+        pending.target = shader.get();
+        std::vector<std::string> files;
+        if (LoadShaderStages(shader->vertex_path_, shader->fragment_path_, pending.vertex_source,
+                             pending.fragment_source, files))
+        {
+            std::cout << "Reloading shader: " << path << "\n";
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_shaders_.push_back(std::move(pending));
+        }
+    }
+
+    for (TextureAsset const& texture : textures_)
+    {
+        if (path != texture.path)
+        {
+            continue;
+        }
+
+        PendingTexture decoded;
+        if (DecodeTexture(texture, decoded))
+        {
+            std::cout << "Reloading texture: " << path << "\n";
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_textures_.push_back(std::move(decoded));
+        }
+    }
+
+    if (on_change_)
+    {
+        on_change_();
+    }
+}
+
+bool AssetReloader::DecodeTexture(TextureAsset const& asset, PendingTexture& decoded)
+{
+    PROFILE_ZONE("stbi_load");
+    // 只影响当前线程，监视线程和渲染线程互不干扰
+    stbi_set_flip_vertically_on_load_thread(asset.flip_vertically);
+    uint8_t* pixels = stbi_load(asset.path.c_str(), &decoded.width, &decoded.height, &decoded.channels, 0);
+    if (!pixels)
+    {
+        std::cout << "ERROR: Load image failed: " << asset.path << " (" << stbi_failure_reason() << ")\n";
+        return false;
+    }
+
+    decoded.texture = asset.texture;
+    decoded.pixels = std::shared_ptr<uint8_t>(pixels, stbi_image_free);
+    return true;
+}
+
+bool AssetReloader::ApplyPending()
+{
+    std::vector<PendingShader> shaders;
+    std::vector<PendingTexture> textures;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shaders.swap(pending_shaders_);
+        textures.swap(pending_textures_);
+    }
+
+    for (PendingTexture const& texture : textures)
+    {
+        PROFILE_ZONE("AssetReloader::UploadTexture");
+        UploadTexture2D(texture.texture, texture.width, texture.height, texture.channels, texture.pixels.get());
+    }
+
+    // 同一个 shader 连续修改时，新提交的编译直接替换还没完成的那个
+    for (PendingShader const& pending : shaders)
+    {
+        pending.target->building_ = std::make_unique<Shader>(pending.vertex_source.c_str(),
+                                                             pending.fragment_source.c_str(), ShaderBuild::Async);
+    }
+
+    bool building = false;
+    for (auto& shader : shaders_)
+    {
+        if (shader->building_)
+        {
+            if (!shader->building_->IsReady())
+            {
+                building = true;
+                continue;
+            }
+
+            if (shader->building_->IsLinked())
+            {
+                shader->current_ = std::move(shader->building_);
+                shader->current_loaded_ = false;
+            }
+            else
+            {
+                // 错误信息已经在 Shader 里输出，保留旧的 program
+                shader->building_.reset();
+            }
+        }
+
+        if (!shader->current_loaded_)
+        {
+            if (!shader->current_->IsReady())
+            {
+                building = true;
+                continue;
+            }
+
+            shader->current_loaded_ = true;
+            if (shader->on_load_ && shader->current_->IsLinked())
+            {
+                shader->current_->Use();
+                shader->on_load_(*shader->current_);
+            }
+        }
+    }
+    return building;
+}
+
+} // namespace utils
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "file_watcher.h"
+#include "gl_include.h"
+#include "shader.h"
+#include "shader_preprocessor.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+// 从文件加载、可以热重载的 shader。替换发生在 AssetReloader::ApplyPending 里，
+// 因此同一帧内 Get() 返回的对象不会变化；不要跨帧保存 Get() 的引用。
+class ReloadableShader
+{
+public:
+    Shader& Get()
+    {
+        return *current_;
+    }
+
+    // 当前 program 已经编译完成并且链接成功
+    bool IsReady()
+    {
+        return current_->IsReady() && current_->IsLinked();
+    }
+
+private:
+    friend class AssetReloader;
+
+    std::string vertex_path_;
+    std::string fragment_path_;
+    // 两个阶段展开 #include 时读过的所有文件
+    std::vector<std::string> files_;
+    // 每次有新的 program 替换上来之后调用，用来设置 sampler 等只需要设置一次的 uniform
+    std::function<void(Shader&)> on_load_;
+    std::unique_ptr<Shader> current_;
+    bool current_loaded_ = false;
+    // 正在后台编译的新版本，编译失败时丢弃，继续使用旧的
+    std::unique_ptr<Shader> building_;
+};
+
+// 文件形式的 shader 和纹理，以及它们的热重载
+//
+// 监视线程发现文件变化后，在监视线程上读取 GLSL 源码、解码图片，渲染线程只在帧边界
+// （ApplyPending）提交异步编译和上传纹理，编译完成后才替换，因此不会卡住消息循环。
+class AssetReloader
+{
+public:
+    AssetReloader() = default;
+    ~AssetReloader();
+
+    AssetReloader(AssetReloader const&) = delete;
+    AssetReloader& operator=(AssetReloader const&) = delete;
+
+    // 立即读取文件、展开 #include 并提交异步编译，返回的对象在 AssetReloader 销毁前有效。
+    // 修改被包含的文件也会触发重新编译（热重载期间新加入的 #include 不会被监视）
+    ReloadableShader& AddShader(std::string const& vertex_path, std::string const& fragment_path,
+                                std::function<void(Shader&)> on_load = {});
+
+    // texture 需要已经创建并设置好参数，文件变化后重新上传到同一个纹理对象；首次加载失败时返回 false
+    bool AddTexture(GLuint texture, std::string const& path, bool flip_vertically = false);
+
+    // 开始监视已添加的文件，on_change 在监视线程上调用，OnDemand 模式下用来唤醒消息循环
+    bool StartWatching(std::function<void()> on_change = {});
+
+    // 在渲染线程、绘制之前调用。返回 true 表示还有 shader 在编译，需要继续调度下一帧
+    bool ApplyPending();
+
+private:
+    struct TextureAsset
+    {
+        GLuint texture = 0;
+        std::string path;
+        bool flip_vertically = false;
+    };
+
+    struct PendingShader
+    {
+        ReloadableShader* target = nullptr;
+        std::string vertex_source;
+        std::string fragment_source;
+    };
+
+    struct PendingTexture
+    {
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        std::shared_ptr<uint8_t> pixels;
+    };
+
+    void OnFileChanged(std::string const& path);
+    static bool DecodeTexture(TextureAsset const& asset, PendingTexture& decoded);
+
+private:
+    std::vector<std::unique_ptr<ReloadableShader>> shaders_;
+    std::vector<TextureAsset> textures_;
+    FileWatcher watcher_;
+    std::function<void()> on_change_;
+
+    // 监视线程产出，渲染线程消费
+    std::mutex mutex_;
+    std::vector<PendingShader> pending_shaders_;
+    std::vector<PendingTexture> pending_textures_;
+};
+
+} // namespace utils
@@ -0,0 +1,336 @@
+#include "block_compression.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+// clang-format off
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define UTILS_BLOCK_SSE2 1
+    #include <emmintrin.h>
+#endif
+// clang-format on
+
+namespace utils {
+
+namespace {
+
+constexpr int BLOCK_PIXELS = 16;
+
+// 取出第 (block_x, block_y) 块的 16 个像素并转换成 RGBA，超出图片的部分夹到边缘
+void GatherBlock(const uint8_t* pixels, int width, int height, int channels, int block_x, int block_y,
+                 uint8_t block[BLOCK_PIXELS * 4])
+{
+    for (int row = 0; row < 4; ++row)
+    {
+        int y = std::min(block_y * 4 + row, height - 1);
+        for (int column = 0; column < 4; ++column)
+        {
+            int x = std::min(block_x * 4 + column, width - 1);
+            const uint8_t* in = pixels + (static_cast<size_t>(y) * width + x) * channels;
+            uint8_t* out = block + (row * 4 + column) * 4;
+            switch (channels)
+            {
+            case 1:
+                out[0] = out[1] = out[2] = in[0];
+                out[3] = 255;
+                break;
+            case 2:
+                out[0] = out[1] = out[2] = in[0];
+                out[3] = in[1];
+                break;
+            case 3:
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+                out[3] = 255;
+                break;
+            default:
+                memcpy(out, in, 4);
+                break;
+            }
+        }
+    }
+}
+
+uint16_t PackRgb565(const uint8_t color[3])
+{
+    int r = (color[0] * 31 + 127) / 255;
+    int g = (color[1] * 63 + 127) / 255;
+    int b = (color[2] * 31 + 127) / 255;
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+void UnpackRgb565(uint16_t packed, int color[3])
+{
+    int r = packed >> 11 & 31;
+    int g = packed >> 5 & 63;
+    int b = packed & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// 像素在端点连线上的位置，0 对应 color1、3 对应 color0，四舍五入
+void ProjectPixels(const uint8_t block[BLOCK_PIXELS * 4], int const base[3], int const direction[3], float scale,
+                   int steps[BLOCK_PIXELS])
+{
+#if defined(UTILS_BLOCK_SSE2)
+    // 每次 4 个像素：扩展到 16 位减去 base，和 (dr, dg, db, 0) 做 madd 得到 rg / ba 两半的点积
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i base16 = _mm_setr_epi16(static_cast<short>(base[0]), static_cast<short>(base[1]),
+                                          static_cast<short>(base[2]), 0, static_cast<short>(base[0]),
+                                          static_cast<short>(base[1]), static_cast<short>(base[2]), 0);
+    const __m128i direction16 =
+        _mm_setr_epi16(static_cast<short>(direction[0]), static_cast<short>(direction[1]),
+                       static_cast<short>(direction[2]), 0, static_cast<short>(direction[0]),
+                       static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0);
+    const __m128 scale4 = _mm_set1_ps(scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (int i = 0; i < BLOCK_PIXELS; i += 4)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4));
+        __m128i lo = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), base16), direction16);
+        __m128i hi = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), base16), direction16);
+        // lo = [p0.rg, p0.ba, p1.rg, p1.ba]，hi 同理，把每个像素的两半加起来
+        __m128 rg = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 ba = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i dot = _mm_add_epi32(_mm_castps_si128(rg), _mm_castps_si128(ba));
+        __m128 t = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(dot), scale4), half);
+        __m128i step = _mm_cvttps_epi32(_mm_max_ps(t, _mm_setzero_ps()));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(steps + i), step);
+    }
+    for (int i = 0; i < BLOCK_PIXELS; ++i)
+    {
+        steps[i] = std::min(steps[i], 3);
+    }
+#else
+    for (int i = 0; i < BLOCK_PIXELS; ++i)
+    {
+        const uint8_t* pixel = block + i * 4;
+        int dot = (pixel[0] - base[0]) * direction[0] + (pixel[1] - base[1]) * direction[1] +
+                  (pixel[2] - base[2]) * direction[2];
+        float t = static_cast<float>(dot) * scale + 0.5f;
+        steps[i] = std::clamp(static_cast<int>(std::max(t, 0.0f)), 0, 3);
+    }
+#endif
+}
+
+void EncodeColorBlock(const uint8_t block[BLOCK_PIXELS * 4], uint8_t out[8])
+{
+    uint8_t min_color[3] = {255, 255, 255};
+    uint8_t max_color[3] = {0, 0, 0};
+    for (int i = 0; i < BLOCK_PIXELS; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            min_color[c] = std::min(min_color[c], block[i * 4 + c]);
+            max_color[c] = std::max(max_color[c], block[i * 4 + c]);
+        }
+    }
+
+    // 包围盒有四条对角线，按红、蓝相对绿的协方差符号选出与颜色分布一致的那条
+    int center[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        center[c] = (min_color[c] + max_color[c] + 1) / 2;
+    }
+    int covariance_rg = 0;
+    int covariance_bg = 0;
+    for (int i = 0; i < BLOCK_PIXELS; ++i)
+    {
+        int g = block[i * 4 + 1] - center[1];
+        covariance_rg += (block[i * 4 + 0] - center[0]) * g;
+        covariance_bg += (block[i * 4 + 2] - center[2]) * g;
+    }
+    if (covariance_rg < 0)
+    {
+        std::swap(min_color[0], max_color[0]);
+    }
+    if (covariance_bg < 0)
+    {
+        std::swap(min_color[2], max_color[2]);
+    }
+
+    // 端点向内收缩 1/16，减小两端的量化误差
+    for (int c = 0; c < 3; ++c)
+    {
+        int inset = (max_color[c] - min_color[c]) / 16;
+        min_color[c] = static_cast<uint8_t>(min_color[c] + inset);
+        max_color[c] = static_cast<uint8_t>(max_color[c] - inset);
+    }
+
+    uint16_t color0 = PackRgb565(max_color);
+    uint16_t color1 = PackRgb565(min_color);
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        // 4 色模式要求 color0 > color1；索引按交换后的端点计算，不需要再对调
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        // 按量化后的端点投影，和硬件解出的调色板一致
+        int end0[3];
+        int end1[3];
+        UnpackRgb565(color0, end0);
+        UnpackRgb565(color1, end1);
+        int direction[3] = {end0[0] - end1[0], end0[1] - end1[1], end0[2] - end1[2]};
+        int length2 = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+        float scale = length2 > 0 ? 3.0f / static_cast<float>(length2) : 0.0f;
+
+        int steps[BLOCK_PIXELS];
+        ProjectPixels(block, end1, direction, scale, steps);
+        // 调色板顺序是 color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+        static constexpr uint32_t STEP_TO_INDEX[4] = {1, 3, 2, 0};
+        for (int i = 0; i < BLOCK_PIXELS; ++i)
+        {
+            indices |= STEP_TO_INDEX[steps[i]] << (i * 2);
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+    out[4] = static_cast<uint8_t>(indices);
+    out[5] = static_cast<uint8_t>(indices >> 8);
+    out[6] = static_cast<uint8_t>(indices >> 16);
+    out[7] = static_cast<uint8_t>(indices >> 24);
+}
+
+void EncodeAlphaBlock(const uint8_t block[BLOCK_PIXELS * 4], uint8_t out[8])
+{
+    int min_alpha = 255;
+    int max_alpha = 0;
+    for (int i = 0; i < BLOCK_PIXELS; ++i)
+    {
+        min_alpha = std::min(min_alpha, static_cast<int>(block[i * 4 + 3]));
+        max_alpha = std::max(max_alpha, static_cast<int>(block[i * 4 + 3]));
+    }
+
+    // alpha0 > alpha1 时是 8 级插值：索引 0 / 1 是两端，2..7 从 alpha0 向 alpha1 过渡
+    uint64_t indices = 0;
+    if (max_alpha != min_alpha)
+    {
+        int range = max_alpha - min_alpha;
+        for (int i = 0; i < BLOCK_PIXELS; ++i)
+        {
+            int step = ((block[i * 4 + 3] - min_alpha) * 7 + range / 2) / range;
+            uint64_t index = step == 7 ? 0 : step == 0 ? 1 : static_cast<uint64_t>(8 - step);
+            indices |= index << (i * 3);
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(max_alpha);
+    out[1] = static_cast<uint8_t>(min_alpha);
+    for (int i = 0; i < 6; ++i)
+    {
+        out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+void CompressBlockRows(const uint8_t* pixels, int width, int height, int channels, BlockFormat format, int first_row,
+                       int last_row, uint8_t* out)
+{
+    int blocks_x = (width + 3) / 4;
+    size_t block_bytes = format == BlockFormat::BC1 ? 8 : 16;
+    uint8_t block[BLOCK_PIXELS * 4];
+    for (int block_y = first_row; block_y < last_row; ++block_y)
+    {
+        uint8_t* target = out + static_cast<size_t>(block_y) * blocks_x * block_bytes;
+        for (int block_x = 0; block_x < blocks_x; ++block_x)
+        {
+            GatherBlock(pixels, width, height, channels, block_x, block_y, block);
+            if (format == BlockFormat::BC3)
+            {
+                EncodeAlphaBlock(block, target);
+                target += 8;
+            }
+            EncodeColorBlock(block, target);
+            target += 8;
+        }
+    }
+}
+
+} // namespace
+
+BlockFormat BlockFormatForChannels(int channels)
+{
+    return channels == 2 || channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+GLenum BlockFormatInternalFormat(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+size_t CompressedImageSize(GLenum internal_format, int width, int height)
+{
+    switch (internal_format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return CompressedImageSize(BlockFormat::BC1, width, height);
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return CompressedImageSize(BlockFormat::BC3, width, height);
+    default:
+        return 0;
+    }
+}
+
+size_t CompressedImageSize(BlockFormat format, int width, int height)
+{
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * static_cast<size_t>((height + 3) / 4);
+    return blocks * (format == BlockFormat::BC1 ? 8 : 16);
+}
+
+std::vector<uint8_t> CompressImage(const uint8_t* pixels, int width, int height, int channels, BlockFormat format,
+                                   ThreadPool* pool)
+{
+    PROFILE_ZONE("CompressImage");
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4)
+    {
+        return {};
+    }
+    std::vector<uint8_t> compressed(CompressedImageSize(format, width, height));
+
+    int block_rows = (height + 3) / 4;
+    if (!pool || block_rows < 2)
+    {
+        CompressBlockRows(pixels, width, height, channels, format, 0, block_rows, compressed.data());
+        return compressed;
+    }
+
+    // 每个线程分几段，块行之间的耗时不均匀时也能分摊开
+    int chunk_count = std::min(block_rows, static_cast<int>(pool->ThreadCount()) * 4);
+    int rows_per_chunk = (block_rows + chunk_count - 1) / chunk_count;
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    int remaining = 0;
+    for (int first = 0; first < block_rows; first += rows_per_chunk)
+    {
+        int last = std::min(block_rows, first + rows_per_chunk);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++remaining;
+        }
+        pool->Submit([&, first, last] {
+            CompressBlockRows(pixels, width, height, channels, format, first, last, compressed.data());
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+            {
+                done_cv.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [&] { return remaining == 0; });
+    return compressed;
+}
+
+} // namespace utils
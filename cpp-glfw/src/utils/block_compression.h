@@ -0,0 +1,45 @@
+#pragma once
+
+#include "gl_include.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GL_EXT_texture_compression_s3tc，glad 生成时没有包含扩展，这里手动补上
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace utils {
+
+class ThreadPool;
+
+// 4x4 像素一块的 S3TC 压缩格式
+enum class BlockFormat
+{
+    // 8 字节一块，只有 RGB，显存是 RGBA8 的 1/8
+    BC1,
+    // 16 字节一块，BC1 的颜色加上 8 级插值的 alpha，显存是 RGBA8 的 1/4
+    BC3,
+};
+
+// 不透明（1、3 通道）用 BC1，带 alpha（2、4 通道）用 BC3
+BlockFormat BlockFormatForChannels(int channels);
+
+GLenum BlockFormatInternalFormat(BlockFormat format);
+
+// 按 GL 内部格式求压缩后的字节数，不是 S3TC 格式时返回 0
+size_t CompressedImageSize(GLenum internal_format, int width, int height);
+
+size_t CompressedImageSize(BlockFormat format, int width, int height);
+
+// 把 channels 通道紧密排列的图片压缩成 BC1 / BC3，宽高不是 4 的倍数时边缘的块重复最后一行 / 列。
+// 颜色端点取包围盒沿主对角线的两个角（向内收缩 1/16），x86 上用 SSE2 把像素投影到端点连线上选索引。
+// pool 不为空时按块行分给工作线程并等待完成；不要在 pool 自己的任务里传入同一个 pool
+std::vector<uint8_t> CompressImage(const uint8_t* pixels, int width, int height, int channels, BlockFormat format,
+                                   ThreadPool* pool = nullptr);
+
+} // namespace utils
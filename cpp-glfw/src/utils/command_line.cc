@@ -0,0 +1,136 @@
+#include "command_line.h"
+#include "file_path.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+namespace utils {
+
+RunOptions ParseCommandLine(int argc, char* argv[])
+{
+    RunOptions options;
+    int warmup_frames = -1;
+    bool shader_cache = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        bool has_value = (i + 1 < argc);
+
+        if (strcmp(arg, "--headless") == 0)
+        {
+            options.headless = true;
+        }
+        else if (strcmp(arg, "--frames") == 0 && has_value)
+        {
+            options.frame_count = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "--bench") == 0)
+        {
+            options.bench = true;
+        }
+        else if (strcmp(arg, "--gpu-timing") == 0)
+        {
+            options.gpu_timing = true;
+        }
+        else if (strcmp(arg, "--trace") == 0 && has_value)
+        {
+            options.trace_path = argv[++i];
+        }
+        else if (strcmp(arg, "--update-rate") == 0 && has_value)
+        {
+            options.update_rate = atof(argv[++i]);
+        }
+        else if (strcmp(arg, "--capture") == 0 && has_value)
+        {
+            options.capture_path = argv[++i];
+        }
+        else if (strcmp(arg, "--record") == 0 && has_value)
+        {
+            options.record_path = argv[++i];
+        }
+        else if (strcmp(arg, "--vsync") == 0 && has_value)
+        {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "off") == 0)
+            {
+                options.vsync = VsyncMode::Off;
+            }
+            else if (strcmp(mode, "adaptive") == 0)
+            {
+                options.vsync = VsyncMode::Adaptive;
+            }
+            else
+            {
+                options.vsync = VsyncMode::On;
+            }
+        }
+        else if (strcmp(arg, "--fps-cap") == 0 && has_value)
+        {
+            options.fps_cap = atof(argv[++i]);
+        }
+        else if (strcmp(arg, "--spin-ms") == 0 && has_value)
+        {
+            options.spin_margin_ms = atof(argv[++i]);
+        }
+        else if (strcmp(arg, "--shader-cache") == 0 && has_value)
+        {
+            options.shader_cache_dir = argv[++i];
+        }
+        else if (strcmp(arg, "--no-shader-cache") == 0)
+        {
+            shader_cache = false;
+        }
+        else if (strcmp(arg, "--assets") == 0 && has_value)
+        {
+            options.asset_dir = argv[++i];
+        }
+        else if (strcmp(arg, "--hot-reload") == 0)
+        {
+            options.hot_reload = true;
+        }
+        else if (strcmp(arg, "--warmup") == 0 && has_value)
+        {
+            warmup_frames = atoi(argv[++i]);
+        }
+    }
+
+    if (!options.vsync)
+    {
+        // benchmark 测的是 CPU 帧时间，不能被 vsync 限速
+        options.vsync = options.bench ? VsyncMode::Off : VsyncMode::On;
+    }
+
+    if (options.bench)
+    {
+        if (options.frame_count <= 0)
+        {
+            options.frame_count = DEFAULT_BENCH_FRAMES;
+        }
+        options.warmup_frames = (warmup_frames >= 0) ? warmup_frames : DEFAULT_BENCH_WARMUP_FRAMES;
+    }
+
+    if ((options.headless || !options.capture_path.empty()) && options.frame_count <= 0)
+    {
+        options.frame_count = DEFAULT_HEADLESS_FRAMES;
+    }
+
+    if (!shader_cache)
+    {
+        options.shader_cache_dir.clear();
+    }
+    else if (options.shader_cache_dir.empty())
+    {
+        options.shader_cache_dir = (std::filesystem::path(GetExecutableDir()) / DEFAULT_SHADER_CACHE_DIR).string();
+    }
+
+    if (options.asset_dir.empty())
+    {
+        options.asset_dir = (std::filesystem::path(GetExecutableDir()) / DEFAULT_ASSET_DIR).string();
+    }
+
+    return options;
+}
+
+} // namespace utils
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "frame_pacer.h"
+#include <optional>
+#include <string>
+
+namespace utils {
+
+// headless 模式下未指定 --frames 时运行的帧数
+constexpr int DEFAULT_HEADLESS_FRAMES = 60;
+// benchmark 模式下的默认预热帧数和统计帧数
+constexpr int DEFAULT_BENCH_WARMUP_FRAMES = 60;
+constexpr int DEFAULT_BENCH_FRAMES = 600;
+// program 二进制缓存在可执行文件目录下的子目录名
+constexpr char DEFAULT_SHADER_CACHE_DIR[] = "shader_cache";
+constexpr char DEFAULT_ASSET_DIR[] = "assets";
+
+struct RunOptions
+{
+    // 不创建可见窗口，渲染到离屏 FBO
+    bool headless = false;
+    // 运行的帧数，0 表示一直运行直到窗口关闭
+    int frame_count = 0;
+    // 关闭 vsync，统计帧时间并以 JSON 输出
+    bool bench = false;
+    // 预热帧数，不计入统计，也不计入 frame_count
+    int warmup_frames = 0;
+    // 用时间戳查询统计 GPU 耗时，退出时以 JSON 输出
+    bool gpu_timing = false;
+    // 非空时记录 CPU 打点，退出时写出 Chrome trace JSON
+    std::string trace_path;
+    // 模拟频率（Hz），0 表示使用默认值
+    double update_rate = 0.0;
+    // 非空时把最后一帧读回并保存为 PNG，同时使用确定性的帧时钟
+    std::string capture_path;
+    // 非空时录制每一帧（.y4m 或裸 RGBA）
+    std::string record_path;
+    // 未指定时默认开启 vsync（benchmark 模式下默认关闭）
+    std::optional<VsyncMode> vsync;
+    // 帧率上限，0 表示不限制
+    double fps_cap = 0.0;
+    // 帧率限制里自旋等待的时长（毫秒）
+    double spin_margin_ms = FramePacer::DEFAULT_SPIN_MARGIN_MS;
+    // program 二进制缓存目录，默认在可执行文件旁边，空表示不缓存
+    std::string shader_cache_dir;
+    // 文件形式的资源（GLSL、图片）所在目录，默认是可执行文件旁边拷贝过去的 assets
+    std::string asset_dir;
+    // 监视资源文件，修改后自动重新编译 shader、重新加载纹理
+    bool hot_reload = false;
+};
+
+// 支持的参数:
+//   --headless     离屏渲染，不需要显示器
+//   --frames N     渲染 N 帧后退出（benchmark 模式下为统计帧数）
+//   --bench        benchmark 模式
+//   --warmup N     benchmark 模式的预热帧数
+//   --gpu-timing   统计 GPU 耗时
+//   --trace FILE   写出 Chrome trace_event JSON
+//   --update-rate HZ  固定步长模拟的频率
+//   --capture FILE 保存最后一帧为 PNG（用于 golden image 对比）
+//   --record FILE  录制所有帧，FILE 以 .y4m 结尾时写 Y4M，否则写裸 RGBA
+//   --vsync on|off|adaptive
+//   --fps-cap N    限制帧率，退出时输出帧间隔抖动统计
+//   --spin-ms MS   帧率限制中 sleep 之后自旋等待的时长
+//   --shader-cache DIR  program 二进制缓存目录
+//   --no-shader-cache   总是重新编译 shader
+//   --assets DIR   资源目录，热重载时通常指向源码里的 assets，例如 --assets ../src/assets
+//   --hot-reload   监视资源文件并热重载
+RunOptions ParseCommandLine(int argc, char* argv[]);
+
+} // namespace utils
@@ -0,0 +1,159 @@
+#include "cooked_texture.h"
+#include "block_compression.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace utils {
+
+namespace cooked_texture {
+
+namespace {
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool Fail(std::string* error, std::string message)
+{
+    if (error)
+    {
+        *error = std::move(message);
+    }
+    return false;
+}
+
+} // namespace
+
+bool Parse(const void* data, size_t size, View& view, std::string* error)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (size < sizeof(Header))
+    {
+        return Fail(error, "file is too small");
+    }
+
+    // 映射的起始地址按页对齐，头部和级别表可以直接按结构体访问
+    auto header = reinterpret_cast<Header const*>(bytes);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return Fail(error, "not a cooked texture");
+    }
+    if (header->version != VERSION)
+    {
+        return Fail(error, "unsupported version " + std::to_string(header->version));
+    }
+    if (header->width == 0 || header->height == 0 || header->channels == 0 || header->channels > 4 ||
+        header->level_count == 0 || header->level_count > 32)
+    {
+        return Fail(error, "invalid header");
+    }
+    if (header->format != 0 && CompressedImageSize(header->format, 1, 1) == 0)
+    {
+        return Fail(error, "unsupported format " + std::to_string(header->format));
+    }
+
+    size_t table_end = sizeof(Header) + sizeof(Level) * header->level_count;
+    if (size < table_end)
+    {
+        return Fail(error, "truncated level table");
+    }
+
+    auto levels = reinterpret_cast<Level const*>(bytes + sizeof(Header));
+    for (uint32_t i = 0; i < header->level_count; ++i)
+    {
+        Level const& level = levels[i];
+        uint64_t expected = header->format == 0
+                                ? uint64_t{level.width} * level.height * header->channels
+                                : CompressedImageSize(header->format, static_cast<int>(level.width),
+                                                      static_cast<int>(level.height));
+        if (level.width == 0 || level.height == 0 || level.size != expected || level.offset % ALIGNMENT != 0 ||
+            level.offset < table_end || level.offset > size || level.size > size - level.offset)
+        {
+            return Fail(error, "invalid level " + std::to_string(i));
+        }
+    }
+
+    view.header = header;
+    view.levels = levels;
+    view.data = bytes;
+    return true;
+}
+
+bool Write(std::string const& path, int channels, uint32_t format, uint32_t flags, uint64_t content_hash,
+           std::vector<LevelImage> const& levels, std::string* error)
+{
+    if (levels.empty() || channels < 1 || channels > 4)
+    {
+        return Fail(error, "nothing to write");
+    }
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = static_cast<uint32_t>(levels[0].width);
+    header.height = static_cast<uint32_t>(levels[0].height);
+    header.channels = static_cast<uint32_t>(channels);
+    header.level_count = static_cast<uint32_t>(levels.size());
+    header.flags = flags;
+    header.format = format;
+    header.content_hash = content_hash;
+
+    std::vector<Level> table(levels.size());
+    size_t offset = AlignUp(sizeof(Header) + sizeof(Level) * levels.size(), ALIGNMENT);
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        table[i].offset = offset;
+        table[i].size = levels[i].pixels.size();
+        table[i].width = static_cast<uint32_t>(levels[i].width);
+        table[i].height = static_cast<uint32_t>(levels[i].height);
+        offset = AlignUp(offset + levels[i].pixels.size(), ALIGNMENT);
+    }
+
+    // 先写临时文件再改名，构建中断时不会留下半个文件
+    std::filesystem::path target(path);
+    std::error_code ec;
+    if (target.has_parent_path())
+    {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return Fail(error, "cannot open " + temp_path);
+        }
+
+        static const char padding[ALIGNMENT] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()),
+                  static_cast<std::streamsize>(sizeof(Level) * table.size()));
+        size_t written = sizeof(header) + sizeof(Level) * table.size();
+        for (size_t i = 0; i < levels.size(); ++i)
+        {
+            out.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+            out.write(reinterpret_cast<const char*>(levels[i].pixels.data()),
+                      static_cast<std::streamsize>(levels[i].pixels.size()));
+            written = table[i].offset + levels[i].pixels.size();
+        }
+        if (!out)
+        {
+            return Fail(error, "write failed: " + temp_path);
+        }
+    }
+
+    std::filesystem::rename(temp_path, target, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return Fail(error, "cannot rename to " + path);
+    }
+    return true;
+}
+
+} // namespace cooked_texture
+
+} // namespace utils
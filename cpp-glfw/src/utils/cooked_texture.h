@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+// 烘焙纹理（.gltex），由 texture-cooker 在构建时生成，运行时映射文件后直接上传，不需要解码和生成 mipmap
+//
+// 布局（小端序）：CookedTextureHeader，紧跟 level_count 个 CookedTextureLevel，然后是各级像素。
+// 每一级的起始位置按 COOKED_TEXTURE_ALIGNMENT 对齐，行之间没有填充；
+// 三通道图片烘焙时已经扩展为 RGBA，因此各级都可以用默认的 GL_UNPACK_ALIGNMENT 上传。
+// format 不为 0 时各级是该 GL 压缩格式的块数据（见 utils/block_compression.h），
+// 用 glCompressedTexSubImage2D 上传。
+namespace cooked_texture {
+
+constexpr char MAGIC[4] = {'G', 'L', 'T', 'X'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t ALIGNMENT = 64;
+constexpr const char* EXTENSION = ".gltex";
+
+// Header::flags：像素已经上下翻转（第一行是图片的最后一行）
+constexpr uint32_t FLIPPED_VERTICALLY = 1u << 0;
+
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t level_count;
+    uint32_t flags;
+    // 0 表示未压缩，否则是 GL 压缩内部格式
+    uint32_t format;
+    // 源图片文件的 Fnv1a64，用于和未烘焙的同一张图片去重
+    uint64_t content_hash;
+};
+
+struct Level
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+static_assert(sizeof(Header) == 40 && sizeof(Level) == 24, "cooked texture layout must not depend on the compiler");
+
+// 指向映射内存的视图，不拥有数据
+struct View
+{
+    Header const* header = nullptr;
+    Level const* levels = nullptr;
+    const uint8_t* data = nullptr;
+
+    const uint8_t* LevelPixels(uint32_t level) const
+    {
+        return data + levels[level].offset;
+    }
+};
+
+// 校验头部和每一级的范围
+bool Parse(const void* data, size_t size, View& view, std::string* error = nullptr);
+
+struct LevelImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// levels 从第 0 级开始，format 为 0 时像素按 channels 紧密排列，否则是压缩后的块数据
+bool Write(std::string const& path, int channels, uint32_t format, uint32_t flags, uint64_t content_hash,
+           std::vector<LevelImage> const& levels, std::string* error = nullptr);
+
+} // namespace cooked_texture
+
+} // namespace utils
@@ -0,0 +1,189 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+namespace {
+
+std::filesystem::file_time_type GetWriteTime(std::filesystem::path const& path)
+{
+    std::error_code error;
+    auto write_time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type{} : write_time;
+}
+
+} // namespace
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+void FileWatcher::Watch(std::string const& path)
+{
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::weakly_canonical(path, error);
+    if (error)
+    {
+        absolute = std::filesystem::absolute(path);
+    }
+    entries_.push_back({path, absolute, GetWriteTime(absolute)});
+}
+
+bool FileWatcher::Start(Callback callback)
+{
+    if (IsRunning() || entries_.empty())
+    {
+        return false;
+    }
+
+    callback_ = std::move(callback);
+    stopping_ = false;
+
+#ifdef __linux__
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0)
+    {
+        thread_ = std::thread(&FileWatcher::InotifyLoop, this);
+        return true;
+    }
+    std::cout << "WARNING: inotify unavailable, falling back to polling\n";
+#endif
+
+    thread_ = std::thread(&FileWatcher::PollLoop, this);
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    stopping_ = true;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+
+#ifdef __linux__
+    if (inotify_fd_ >= 0)
+    {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+#endif
+}
+
+void FileWatcher::InotifyLoop()
+{
+#ifdef __linux__
+    // 每个目录只加一个监视，wd -> 目录
+    std::map<int, std::filesystem::path> directories;
+    for (Entry const& entry : entries_)
+    {
+        std::filesystem::path directory = entry.absolute.parent_path();
+        bool exists = std::any_of(directories.begin(), directories.end(),
+                                  [&directory](auto const& item) { return item.second == directory; });
+        if (exists)
+        {
+            continue;
+        }
+
+        int wd = inotify_add_watch(inotify_fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0)
+        {
+            std::cout << "WARNING: failed to watch " << directory.string() << "\n";
+            continue;
+        }
+        directories[wd] = directory;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    std::vector<size_t> changed;
+    while (!stopping_)
+    {
+        // 有事件之后再等 DEBOUNCE_MS，把同一次保存产生的多个事件合并
+        pollfd fd{inotify_fd_, POLLIN, 0};
+        int timeout = changed.empty() ? POLL_INTERVAL_MS : DEBOUNCE_MS;
+        int ready = poll(&fd, 1, timeout);
+        if (ready <= 0)
+        {
+            if (ready == 0 && !changed.empty())
+            {
+                Notify(changed);
+                changed.clear();
+            }
+            continue;
+        }
+
+        ssize_t length = 0;
+        while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + length;)
+            {
+                auto const* event = reinterpret_cast<inotify_event const*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                auto directory = directories.find(event->wd);
+                if (directory == directories.end() || event->len == 0)
+                {
+                    continue;
+                }
+
+                std::filesystem::path file = directory->second / event->name;
+                for (size_t i = 0; i < entries_.size(); ++i)
+                {
+                    if (entries_[i].absolute == file && std::find(changed.begin(), changed.end(), i) == changed.end())
+                    {
+                        changed.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+#endif
+}
+
+void FileWatcher::PollLoop()
+{
+    std::vector<size_t> changed;
+    while (!stopping_)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+
+        changed.clear();
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            auto write_time = GetWriteTime(entries_[i].absolute);
+            if (write_time != entries_[i].write_time)
+            {
+                entries_[i].write_time = write_time;
+                changed.push_back(i);
+            }
+        }
+
+        if (!changed.empty())
+        {
+            // 等文件写完
+            std::this_thread::sleep_for(std::chrono::milliseconds(DEBOUNCE_MS));
+            Notify(changed);
+        }
+    }
+}
+
+void FileWatcher::Notify(std::vector<size_t> const& changed)
+{
+    for (size_t index : changed)
+    {
+        callback_(entries_[index].path);
+    }
+}
+
+} // namespace utils
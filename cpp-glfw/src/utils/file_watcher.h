@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+// 在后台线程监视一组文件的修改
+//
+// Linux 上用 inotify 监视文件所在的目录（编辑器保存时常常是写临时文件再改名，直接监视文件会丢失），
+// 其他平台每 POLL_INTERVAL_MS 比较一次修改时间。
+// 同一个文件在 DEBOUNCE_MS 内的多次修改只通知一次，避免读到写了一半的文件。
+class FileWatcher
+{
+public:
+    using Callback = std::function<void(std::string const& path)>;
+
+    static constexpr int POLL_INTERVAL_MS = 250;
+    static constexpr int DEBOUNCE_MS = 50;
+
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(FileWatcher const&) = delete;
+    FileWatcher& operator=(FileWatcher const&) = delete;
+
+    // 必须在 Start 之前调用，path 会被规范化为绝对路径
+    void Watch(std::string const& path);
+
+    // callback 在监视线程上调用，参数是 Watch 时传入的路径
+    bool Start(Callback callback);
+    void Stop();
+
+    bool IsRunning() const
+    {
+        return thread_.joinable();
+    }
+
+private:
+    struct Entry
+    {
+        std::string path;
+        std::filesystem::path absolute;
+        std::filesystem::file_time_type write_time{};
+    };
+
+    void InotifyLoop();
+    void PollLoop();
+    void Notify(std::vector<size_t> const& changed);
+
+private:
+    std::vector<Entry> entries_;
+    Callback callback_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    int inotify_fd_ = -1;
+};
+
+} // namespace utils
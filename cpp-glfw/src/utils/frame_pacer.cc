@@ -0,0 +1,112 @@
+#include "frame_pacer.h"
+#include "gl_include.h"
+
+#include <thread>
+
+namespace utils {
+
+void FramePacer::SetTargetFps(double fps)
+{
+    period_ = fps > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps))
+                        : Clock::duration{0};
+    started_ = false;
+}
+
+void FramePacer::SetSpinMargin(double ms)
+{
+    spin_margin_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+}
+
+void FramePacer::Wait()
+{
+    if (!IsLimited())
+    {
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (!started_)
+    {
+        started_ = true;
+        deadline_ = now + period_;
+        last_wake_ = now;
+        return;
+    }
+
+    if (now < deadline_)
+    {
+        if (deadline_ - now > spin_margin_)
+        {
+            std::this_thread::sleep_for(deadline_ - now - spin_margin_);
+        }
+        while (Clock::now() < deadline_)
+        {
+            std::this_thread::yield();
+        }
+        deadline_ += period_;
+    }
+    else
+    {
+        // 已经错过截止时间：不追帧，从现在重新计时
+        deadline_ = now + period_;
+    }
+
+    Clock::time_point wake = Clock::now();
+    intervals_.Add(std::chrono::duration<double, std::milli>(wake - last_wake_).count());
+    last_wake_ = wake;
+}
+
+FrameStatsSummary FramePacer::IntervalSummary() const
+{
+    return intervals_.Summarize();
+}
+
+void FramePacer::WriteJson(std::ostream& out) const
+{
+    FrameStatsSummary summary = intervals_.Summarize();
+    double target_ms = std::chrono::duration<double, std::milli>(period_).count();
+    out << "{\"pacing\":{\"target_ms\":" << target_ms << ",\"frames\":" << summary.count
+        << ",\"interval_ms\":{\"min\":" << summary.min_ms << ",\"p50\":" << summary.p50_ms
+        << ",\"p99\":" << summary.p99_ms << ",\"max\":" << summary.max_ms << ",\"mean\":" << summary.mean_ms
+        << "},\"jitter_ms\":{\"stddev\":" << summary.stddev_ms
+        << ",\"mean_abs_error\":" << intervals_.MeanAbsDeviation(target_ms) << "}}}\n";
+}
+
+VsyncMode ApplyVsyncMode(VsyncMode mode)
+{
+    if (mode == VsyncMode::Adaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+        !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+    {
+        mode = VsyncMode::On;
+    }
+
+    switch (mode)
+    {
+    case VsyncMode::Off:
+        glfwSwapInterval(0);
+        break;
+    case VsyncMode::On:
+        glfwSwapInterval(1);
+        break;
+    case VsyncMode::Adaptive:
+        glfwSwapInterval(-1);
+        break;
+    }
+    return mode;
+}
+
+const char* VsyncModeName(VsyncMode mode)
+{
+    switch (mode)
+    {
+    case VsyncMode::Off:
+        return "off";
+    case VsyncMode::On:
+        return "on";
+    case VsyncMode::Adaptive:
+        return "adaptive";
+    }
+    return "unknown";
+}
+
+} // namespace utils
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "frame_stats.h"
+#include <chrono>
+#include <ostream>
+
+namespace utils {
+
+enum class VsyncMode
+{
+    Off,
+    On,
+    // 赶上垂直同步时同步，落后时立即交换（需要 *_EXT_swap_control_tear，不支持时退回 On）
+    Adaptive,
+};
+
+// 帧率限制：先 sleep 到截止时间前 spin_margin，再自旋等到截止时间。
+// 单纯 sleep 受系统调度粒度影响误差可达毫秒级，单纯自旋又会占满一个核。
+class FramePacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double DEFAULT_SPIN_MARGIN_MS = 1.5;
+
+    // fps <= 0 表示不限制
+    void SetTargetFps(double fps);
+    void SetSpinMargin(double ms);
+
+    bool IsLimited() const
+    {
+        return period_.count() > 0;
+    }
+
+    // 每帧结束时调用，等待到下一帧的截止时间，并记录实际帧间隔
+    void Wait();
+
+    FrameStatsSummary IntervalSummary() const;
+    void WriteJson(std::ostream& out) const;
+
+private:
+    Clock::duration period_{0};
+    Clock::duration spin_margin_{std::chrono::microseconds(static_cast<int64_t>(DEFAULT_SPIN_MARGIN_MS * 1000))};
+    Clock::time_point deadline_{};
+    Clock::time_point last_wake_{};
+    bool started_ = false;
+    FrameStats intervals_;
+};
+
+// 按模式设置交换间隔，返回实际使用的模式
+VsyncMode ApplyVsyncMode(VsyncMode mode);
+
+const char* VsyncModeName(VsyncMode mode);
+
+} // namespace utils
@@ -0,0 +1,233 @@
+#include "frame_recorder.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace utils {
+
+namespace {
+
+bool EndsWith(std::string const& text, const char* suffix)
+{
+    size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+uint8_t ClampToByte(int value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+} // namespace
+
+FrameRecorder::~FrameRecorder()
+{
+    Stop();
+}
+
+bool FrameRecorder::Start(std::string const& path, int width, int height, int fps)
+{
+    if (recording_ || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_)
+    {
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    frame_index_ = 0;
+    y4m_ = EndsWith(path, ".y4m");
+    if (y4m_)
+    {
+        file_ << "YUV4MPEG2 W" << width_ << " H" << height_ << " F" << fps << ":1 Ip A1:1 C444\n";
+    }
+
+    size_t frame_size = static_cast<size_t>(width_) * height_ * 4;
+    for (auto& slot : slots_)
+    {
+        glGenBuffers(1, &slot.pbo);
+        GLStateCache::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(frame_size), nullptr, GL_STREAM_READ);
+    }
+    GLStateCache::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    stopping_ = false;
+    frames_written_ = 0;
+    writer_ = std::thread(&FrameRecorder::WriterLoop, this);
+    recording_ = true;
+    return true;
+}
+
+void FrameRecorder::CaptureFrame()
+{
+    if (!recording_)
+    {
+        return;
+    }
+    PROFILE_ZONE("FrameRecorder::CaptureFrame");
+
+    // 复用的 slot 里还是 RING_SIZE 帧之前的读回，先取走
+    Slot& slot = slots_[frame_index_ % RING_SIZE];
+    if (slot.fence)
+    {
+        Collect(slot);
+    }
+
+    GLStateCache::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLStateCache::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++frame_index_;
+}
+
+void FrameRecorder::Stop()
+{
+    if (!recording_)
+    {
+        return;
+    }
+
+    // 按提交顺序取回还在环里的帧
+    for (int i = 0; i < RING_SIZE; ++i)
+    {
+        Slot& slot = slots_[(frame_index_ + i) % RING_SIZE];
+        if (slot.fence)
+        {
+            Collect(slot);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+
+    for (auto& slot : slots_)
+    {
+        GLStateCache::Current().DeleteBuffers(1, &slot.pbo);
+        slot.pbo = 0;
+    }
+    file_.close();
+    pending_.clear();
+    free_buffers_.clear();
+    recording_ = false;
+}
+
+void FrameRecorder::Collect(Slot& slot)
+{
+    // 正常情况下 fence 早已完成；只有 GPU 落后超过 RING_SIZE 帧时才会在这里等待
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    std::vector<uint8_t> buffer;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return pending_.size() < MAX_PENDING_FRAMES; });
+        if (!free_buffers_.empty())
+        {
+            buffer = std::move(free_buffers_.back());
+            free_buffers_.pop_back();
+        }
+    }
+
+    size_t frame_size = static_cast<size_t>(width_) * height_ * 4;
+    buffer.resize(frame_size);
+
+    GLStateCache::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(frame_size), GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        memcpy(buffer.data(), mapped, frame_size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    GLStateCache::Current().BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(buffer));
+    }
+    cv_.notify_all();
+}
+
+void FrameRecorder::WriterLoop()
+{
+    for (;;)
+    {
+        std::vector<uint8_t> frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty())
+            {
+                return;
+            }
+            frame = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        // 队列有空位了，唤醒可能在等待的渲染线程
+        cv_.notify_all();
+
+        WriteFrame(frame);
+        ++frames_written_;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_buffers_.push_back(std::move(frame));
+    }
+}
+
+void FrameRecorder::WriteFrame(std::vector<uint8_t> const& rgba)
+{
+    PROFILE_ZONE("FrameRecorder::WriteFrame");
+    size_t row_size = static_cast<size_t>(width_) * 4;
+
+    if (!y4m_)
+    {
+        // GL 的第一行在底部，按自上而下写出
+        for (int y = height_ - 1; y >= 0; --y)
+        {
+            file_.write(reinterpret_cast<const char*>(rgba.data() + y * row_size), static_cast<std::streamsize>(row_size));
+        }
+        return;
+    }
+
+    // BT.601 limited range，Y/U/V 三个平面依次写出
+    size_t plane_size = static_cast<size_t>(width_) * height_;
+    convert_buffer_.resize(plane_size * 3);
+    uint8_t* plane_y = convert_buffer_.data();
+    uint8_t* plane_u = plane_y + plane_size;
+    uint8_t* plane_v = plane_u + plane_size;
+    for (int y = 0; y < height_; ++y)
+    {
+        const uint8_t* src = rgba.data() + (height_ - 1 - y) * row_size;
+        size_t dst = static_cast<size_t>(y) * width_;
+        for (int x = 0; x < width_; ++x, src += 4, ++dst)
+        {
+            int r = src[0];
+            int g = src[1];
+            int b = src[2];
+            plane_y[dst] = ClampToByte(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            plane_u[dst] = ClampToByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            plane_v[dst] = ClampToByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    file_ << "FRAME\n";
+    file_.write(reinterpret_cast<const char*>(convert_buffer_.data()), static_cast<std::streamsize>(convert_buffer_.size()));
+}
+
+} // namespace utils
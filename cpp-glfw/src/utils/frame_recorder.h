@@ -0,0 +1,82 @@
+#pragma once
+
+#include "gl_include.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+// 连续录制帧缓冲
+//
+// 每帧用 glReadPixels 读到像素缓冲对象（PBO）环里，读操作是异步的；
+// RING_SIZE - 1 帧之后再映射对应的 PBO，这时 GPU 早已完成拷贝，不会阻塞管线。
+// 映射出来的像素交给后台线程写文件：扩展名为 .y4m 时转换为 YUV 4:4:4 写成 Y4M，
+// 否则按自上而下的行序写裸 RGBA。
+class FrameRecorder
+{
+public:
+    static constexpr int RING_SIZE = 4;
+    // 写线程积压的帧数上限，超过后渲染线程等待，保证不丢帧
+    static constexpr size_t MAX_PENDING_FRAMES = 16;
+
+    FrameRecorder() = default;
+    ~FrameRecorder();
+
+    FrameRecorder(FrameRecorder const&) = delete;
+    FrameRecorder& operator=(FrameRecorder const&) = delete;
+
+    bool Start(std::string const& path, int width, int height, int fps);
+    // 在交换缓冲之前调用
+    void CaptureFrame();
+    // 取回所有未完成的帧并等待写线程结束，必须在 GL 上下文销毁前调用
+    void Stop();
+
+    bool IsRecording() const
+    {
+        return recording_;
+    }
+
+    uint64_t FramesWritten() const
+    {
+        return frames_written_.load();
+    }
+
+private:
+    struct Slot
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+    };
+
+    void Collect(Slot& slot);
+    void WriterLoop();
+    void WriteFrame(std::vector<uint8_t> const& rgba);
+
+private:
+    bool recording_ = false;
+    bool y4m_ = false;
+    int width_ = 0;
+    int height_ = 0;
+    int frame_index_ = 0;
+    std::array<Slot, RING_SIZE> slots_{};
+
+    std::ofstream file_;
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::vector<uint8_t>> pending_;
+    std::vector<std::vector<uint8_t>> free_buffers_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> frames_written_{0};
+    std::vector<uint8_t> convert_buffer_;
+};
+
+} // namespace utils
@@ -0,0 +1,95 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace utils {
+
+namespace {
+
+// nearest-rank 百分位，sorted 必须已排序且非空
+double Percentile(std::vector<double> const& sorted, double percent)
+{
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(sorted.size())));
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1];
+}
+
+} // namespace
+
+void FrameStats::Reserve(size_t count)
+{
+    samples_.reserve(count);
+}
+
+void FrameStats::Add(double frame_ms)
+{
+    samples_.push_back(frame_ms);
+}
+
+void FrameStats::Clear()
+{
+    samples_.clear();
+}
+
+FrameStatsSummary FrameStats::Summarize() const
+{
+    FrameStatsSummary summary;
+    if (samples_.empty())
+    {
+        return summary;
+    }
+
+    std::vector<double> sorted = samples_;
+    std::sort(sorted.begin(), sorted.end());
+
+    summary.count = sorted.size();
+    summary.total_ms = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+    summary.mean_ms = summary.total_ms / static_cast<double>(summary.count);
+    summary.min_ms = sorted.front();
+    summary.p50_ms = Percentile(sorted, 50.0);
+    summary.p95_ms = Percentile(sorted, 95.0);
+    summary.p99_ms = Percentile(sorted, 99.0);
+    summary.max_ms = sorted.back();
+
+    double variance = 0.0;
+    for (double sample : sorted)
+    {
+        variance += (sample - summary.mean_ms) * (sample - summary.mean_ms);
+    }
+    summary.stddev_ms = std::sqrt(variance / static_cast<double>(summary.count));
+    summary.fps = summary.total_ms > 0.0 ? 1000.0 * static_cast<double>(summary.count) / summary.total_ms : 0.0;
+    return summary;
+}
+
+double FrameStats::MeanAbsDeviation(double target_ms) const
+{
+    if (samples_.empty())
+    {
+        return 0.0;
+    }
+
+    double total = 0.0;
+    for (double sample : samples_)
+    {
+        total += std::abs(sample - target_ms);
+    }
+    return total / static_cast<double>(samples_.size());
+}
+
+void WriteFrameStatsJson(std::ostream& out, std::string const& name, FrameStatsSummary const& summary)
+{
+    out << "{\"name\":\"" << name << "\""
+        << ",\"frames\":" << summary.count
+        << ",\"frame_ms\":{\"min\":" << summary.min_ms
+        << ",\"p50\":" << summary.p50_ms
+        << ",\"p95\":" << summary.p95_ms
+        << ",\"p99\":" << summary.p99_ms
+        << ",\"max\":" << summary.max_ms
+        << ",\"mean\":" << summary.mean_ms
+        << ",\"stddev\":" << summary.stddev_ms << "}"
+        << ",\"fps\":" << summary.fps << "}\n";
+}
+
+} // namespace utils
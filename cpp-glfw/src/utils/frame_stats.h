@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+struct FrameStatsSummary
+{
+    size_t count = 0;
+    double total_ms = 0.0;
+    double mean_ms = 0.0;
+    double min_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+    double stddev_ms = 0.0;
+    double fps = 0.0;
+};
+
+// 收集每帧的 CPU 耗时（毫秒），用于 benchmark 统计
+class FrameStats
+{
+public:
+    void Reserve(size_t count);
+    void Add(double frame_ms);
+    void Clear();
+
+    size_t Count() const
+    {
+        return samples_.size();
+    }
+
+    FrameStatsSummary Summarize() const;
+    // 与目标值的平均绝对偏差，用于衡量帧间隔抖动
+    double MeanAbsDeviation(double target_ms) const;
+
+private:
+    std::vector<double> samples_;
+};
+
+// 输出一行 JSON，便于脚本解析和不同构建之间对比
+void WriteFrameStatsJson(std::ostream& out, std::string const& name, FrameStatsSummary const& summary);
+
+} // namespace utils
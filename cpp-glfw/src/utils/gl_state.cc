@@ -0,0 +1,348 @@
+#include "gl_state.h"
+
+#include <cassert>
+
+#define ASSERT assert
+
+namespace utils {
+
+GLStateCache& GLStateCache::Current()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+void GLStateCache::Invalidate()
+{
+    program_ = UNKNOWN;
+    vao_ = UNKNOWN;
+    draw_framebuffer_ = UNKNOWN;
+    read_framebuffer_ = UNKNOWN;
+    active_texture_ = UNKNOWN;
+    buffers_.fill(UNKNOWN);
+    uniform_ranges_.fill(BufferRange{});
+    for (auto& unit : textures_)
+    {
+        unit.fill(UNKNOWN);
+    }
+    samplers_.fill(UNKNOWN);
+    capabilities_.fill(UNKNOWN);
+    blend_func_.fill(UNKNOWN);
+    depth_func_ = UNKNOWN;
+    depth_mask_ = UNKNOWN;
+    viewport_ = {-1, -1, -1, -1};
+}
+
+int GLStateCache::BufferSlotOf(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return BUFFER_ARRAY;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return BUFFER_ELEMENT_ARRAY;
+    case GL_UNIFORM_BUFFER:
+        return BUFFER_UNIFORM;
+    case GL_PIXEL_PACK_BUFFER:
+        return BUFFER_PIXEL_PACK;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return BUFFER_PIXEL_UNPACK;
+    case GL_COPY_READ_BUFFER:
+        return BUFFER_COPY_READ;
+    case GL_COPY_WRITE_BUFFER:
+        return BUFFER_COPY_WRITE;
+    default:
+        return -1;
+    }
+}
+
+int GLStateCache::TextureSlotOf(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return TEXTURE_2D;
+    case GL_TEXTURE_2D_ARRAY:
+        return TEXTURE_2D_ARRAY;
+    case GL_TEXTURE_CUBE_MAP:
+        return TEXTURE_CUBE_MAP;
+    case GL_TEXTURE_3D:
+        return TEXTURE_3D;
+    default:
+        return -1;
+    }
+}
+
+int GLStateCache::CapabilitySlotOf(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_BLEND:
+        return CAP_BLEND;
+    case GL_DEPTH_TEST:
+        return CAP_DEPTH_TEST;
+    case GL_CULL_FACE:
+        return CAP_CULL_FACE;
+    case GL_SCISSOR_TEST:
+        return CAP_SCISSOR_TEST;
+    default:
+        return -1;
+    }
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+    if (Update(program_, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::BindVertexArray(GLuint vao)
+{
+    if (Update(vao_, vao))
+    {
+        glBindVertexArray(vao);
+        // GL_ELEMENT_ARRAY_BUFFER 的绑定属于 VAO
+        buffers_[BUFFER_ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = BufferSlotOf(target);
+    if (slot < 0)
+    {
+        ++counters_.issued;
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if (Update(buffers_[slot], buffer))
+    {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS)
+    {
+        ++counters_.issued;
+        glBindBufferRange(target, index, buffer, offset, size);
+        return;
+    }
+
+    BufferRange& range = uniform_ranges_[index];
+    if (range.buffer == buffer && range.offset == offset && range.size == size)
+    {
+        ++counters_.skipped;
+        return;
+    }
+
+    range = {buffer, offset, size};
+    ++counters_.issued;
+    glBindBufferRange(target, index, buffer, offset, size);
+    // 同时改变了通用绑定点
+    buffers_[BUFFER_UNIFORM] = buffer;
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    bool draw = (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER);
+    bool read = (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER);
+    if ((!draw || draw_framebuffer_ == framebuffer) && (!read || read_framebuffer_ == framebuffer))
+    {
+        ++counters_.skipped;
+        return;
+    }
+
+    if (draw)
+    {
+        draw_framebuffer_ = framebuffer;
+    }
+    if (read)
+    {
+        read_framebuffer_ = framebuffer;
+    }
+    ++counters_.issued;
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GLStateCache::ActiveTexture(GLuint unit)
+{
+    if (active_texture_ != unit)
+    {
+        active_texture_ = unit;
+        ++counters_.issued;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    ASSERT(unit < MAX_TEXTURE_UNITS);
+    int slot = TextureSlotOf(target);
+    if (slot < 0)
+    {
+        ActiveTexture(unit);
+        ++counters_.issued;
+        glBindTexture(target, texture);
+        return;
+    }
+
+    if (Update(textures_[unit][slot], texture))
+    {
+        ActiveTexture(unit);
+        glBindTexture(target, texture);
+    }
+}
+
+void GLStateCache::BindTextureForUpdate(GLuint unit, GLenum target, GLuint texture)
+{
+    BindTexture(unit, target, texture);
+    ActiveTexture(unit);
+}
+
+void GLStateCache::BindSampler(GLuint unit, GLuint sampler)
+{
+    ASSERT(unit < MAX_TEXTURE_UNITS);
+    if (Update(samplers_[unit], sampler))
+    {
+        glBindSampler(unit, sampler);
+    }
+}
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled)
+{
+    int slot = CapabilitySlotOf(capability);
+    if (slot >= 0 && !Update(capabilities_[slot], static_cast<GLuint>(enabled)))
+    {
+        return;
+    }
+
+    if (slot < 0)
+    {
+        ++counters_.issued;
+    }
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+}
+
+void GLStateCache::BlendFunc(GLenum source, GLenum destination)
+{
+    if (Update(blend_func_, {source, destination}))
+    {
+        glBlendFunc(source, destination);
+    }
+}
+
+void GLStateCache::DepthFunc(GLenum func)
+{
+    if (Update(depth_func_, func))
+    {
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::DepthMask(bool write)
+{
+    if (Update(depth_mask_, static_cast<GLuint>(write)))
+    {
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (Update(viewport_, {x, y, width, height}))
+    {
+        glViewport(x, y, width, height);
+    }
+}
+
+void GLStateCache::DeleteProgram(GLuint program)
+{
+    // 正在使用的 program 删除后仍然保持绑定，直到切换到别的 program 时名字才被释放，
+    // 这里保守地置为未知
+    if (program_ == program)
+    {
+        program_ = UNKNOWN;
+    }
+    glDeleteProgram(program);
+}
+
+void GLStateCache::DeleteVertexArrays(GLsizei count, GLuint const* vaos)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        if (vaos[i] != 0 && vao_ == vaos[i])
+        {
+            vao_ = 0;
+            buffers_[BUFFER_ELEMENT_ARRAY] = UNKNOWN;
+        }
+    }
+    glDeleteVertexArrays(count, vaos);
+}
+
+void GLStateCache::DeleteBuffers(GLsizei count, GLuint const* buffers)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        if (buffers[i] == 0)
+        {
+            continue;
+        }
+        // 删除后绑定了它的目标都恢复为 0
+        for (GLuint& bound : buffers_)
+        {
+            if (bound == buffers[i])
+            {
+                bound = 0;
+            }
+        }
+        for (BufferRange& range : uniform_ranges_)
+        {
+            if (range.buffer == buffers[i])
+            {
+                range = BufferRange{};
+            }
+        }
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void GLStateCache::DeleteTextures(GLsizei count, GLuint const* textures)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        if (textures[i] == 0)
+        {
+            continue;
+        }
+        for (auto& unit : textures_)
+        {
+            for (GLuint& bound : unit)
+            {
+                if (bound == textures[i])
+                {
+                    bound = 0;
+                }
+            }
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void GLStateCache::WriteJson(std::ostream& out) const
+{
+    out << "{\"gl_state\":{\"issued\":" << counters_.issued << ",\"skipped\":" << counters_.skipped << "}}\n";
+}
+
+} // namespace utils
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "gl_include.h"
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+namespace utils {
+
+// GL 状态缓存：记录当前上下文里绑定的 program、VAO、缓冲区、纹理单元、sampler、混合、深度和视口，
+// 与缓存相同的设置直接跳过，不进入驱动。
+//
+// 只有所有修改都经过缓存时结果才正确：utils 和示例中的绑定都走这里；
+// 外部代码直接调用 gl* 修改了状态之后要调用 Invalidate()。
+// 删除对象要用这里的 Delete*，否则名字被复用时会误判为已经绑定。
+class GLStateCache
+{
+public:
+    static constexpr int MAX_TEXTURE_UNITS = 32;
+    static constexpr int MAX_UNIFORM_BINDINGS = 16;
+
+    struct Counters
+    {
+        uint64_t issued = 0;
+        uint64_t skipped = 0;
+    };
+
+    GLStateCache()
+    {
+        Invalidate();
+    }
+
+    // 渲染线程当前上下文的缓存（示例只有一个上下文）
+    static GLStateCache& Current();
+
+    // 所有状态变为未知，之后的每个设置都会调用一次 GL
+    void Invalidate();
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    // 支持 ARRAY / ELEMENT_ARRAY / UNIFORM / PIXEL_PACK / PIXEL_UNPACK / COPY_READ / COPY_WRITE，其他目标直接透传
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void BindFramebuffer(GLenum target, GLuint framebuffer);
+    // 绑定到指定纹理单元，需要时才切换 glActiveTexture
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+    // 绑定后要修改纹理（上传、设置参数、生成 mipmap）时使用：即使缓存的绑定没变也切换到 unit，
+    // 保证 glTex* 作用在这个纹理上，而不是当前活动单元上绑定的其他纹理
+    void BindTextureForUpdate(GLuint unit, GLenum target, GLuint texture);
+    void BindSampler(GLuint unit, GLuint sampler);
+
+    // 支持 BLEND / DEPTH_TEST / CULL_FACE / SCISSOR_TEST，其他能力直接透传
+    void SetEnabled(GLenum capability, bool enabled);
+    void BlendFunc(GLenum source, GLenum destination);
+    void DepthFunc(GLenum func);
+    void DepthMask(bool write);
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    void DeleteProgram(GLuint program);
+    void DeleteVertexArrays(GLsizei count, GLuint const* vaos);
+    void DeleteBuffers(GLsizei count, GLuint const* buffers);
+    void DeleteTextures(GLsizei count, GLuint const* textures);
+
+    Counters GetCounters() const
+    {
+        return counters_;
+    }
+
+    void ResetCounters()
+    {
+        counters_ = {};
+    }
+
+    void WriteJson(std::ostream& out) const;
+
+private:
+    // 未知状态，与任何真实值都不相等
+    static constexpr GLuint UNKNOWN = ~0u;
+
+    enum BufferSlot
+    {
+        BUFFER_ARRAY,
+        BUFFER_ELEMENT_ARRAY,
+        BUFFER_UNIFORM,
+        BUFFER_PIXEL_PACK,
+        BUFFER_PIXEL_UNPACK,
+        BUFFER_COPY_READ,
+        BUFFER_COPY_WRITE,
+        BUFFER_SLOT_COUNT,
+    };
+
+    enum TextureSlot
+    {
+        TEXTURE_2D,
+        TEXTURE_2D_ARRAY,
+        TEXTURE_CUBE_MAP,
+        TEXTURE_3D,
+        TEXTURE_SLOT_COUNT,
+    };
+
+    enum CapabilitySlot
+    {
+        CAP_BLEND,
+        CAP_DEPTH_TEST,
+        CAP_CULL_FACE,
+        CAP_SCISSOR_TEST,
+        CAP_SLOT_COUNT,
+    };
+
+    struct BufferRange
+    {
+        GLuint buffer = UNKNOWN;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    static int BufferSlotOf(GLenum target);
+    static int TextureSlotOf(GLenum target);
+    static int CapabilitySlotOf(GLenum capability);
+
+    // 值相同时返回 false 并计数，否则更新缓存
+    template <typename T>
+    bool Update(T& cached, T value)
+    {
+        if (cached == value)
+        {
+            ++counters_.skipped;
+            return false;
+        }
+        cached = value;
+        ++counters_.issued;
+        return true;
+    }
+
+    void ActiveTexture(GLuint unit);
+
+private:
+    GLuint program_ = UNKNOWN;
+    GLuint vao_ = UNKNOWN;
+    GLuint draw_framebuffer_ = UNKNOWN;
+    GLuint read_framebuffer_ = UNKNOWN;
+    GLuint active_texture_ = UNKNOWN;
+    std::array<GLuint, BUFFER_SLOT_COUNT> buffers_{};
+    std::array<BufferRange, MAX_UNIFORM_BINDINGS> uniform_ranges_{};
+    std::array<std::array<GLuint, TEXTURE_SLOT_COUNT>, MAX_TEXTURE_UNITS> textures_{};
+    std::array<GLuint, MAX_TEXTURE_UNITS> samplers_{};
+    // 0 关闭，1 打开，UNKNOWN 未知
+    std::array<GLuint, CAP_SLOT_COUNT> capabilities_{};
+    std::array<GLenum, 2> blend_func_{};
+    GLenum depth_func_ = UNKNOWN;
+    GLuint depth_mask_ = UNKNOWN;
+    std::array<GLint, 4> viewport_{};
+    Counters counters_;
+};
+
+} // namespace utils
@@ -1,7 +1,14 @@
 #include "glfw_module.h"
+#include "file_path.h"
 #include "gl_include.h"
+#include "gl_state.h"
+#include "image_io.h"
+#include "profiler.h"
+#include "program_cache.h"
 
 #include <cassert>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 
 #define ASSERT assert
@@ -15,9 +22,15 @@ void ShowErrorMessage(char const* msg)
 
 GLShaderProgram CreateAndLinkShaders(const char* vertex_shader_source, const char* fragment_shader_source)
 {
+    uint64_t cache_key = program_cache::MakeKey({vertex_shader_source, fragment_shader_source});
+    GLuint shader_program = program_cache::Load(cache_key);
+    if (shader_program)
+    {
+        return shader_program;
+    }
+
     GLuint vertex_shader = 0;
     GLuint fragment_shader = 0;
-    GLuint shader_program = 0;
     GLint success = 0;
     char info_log[512]{};
 
@@ -56,6 +69,7 @@ GLShaderProgram CreateAndLinkShaders(const char* vertex_shader_source, const cha
         shader_program = glCreateProgram();
         glAttachShader(shader_program, vertex_shader);
         glAttachShader(shader_program, fragment_shader);
+        program_cache::PrepareForLink(shader_program);
         glLinkProgram(shader_program);
         // check for linking errors
         glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
@@ -74,15 +88,35 @@ GLShaderProgram CreateAndLinkShaders(const char* vertex_shader_source, const cha
         glDeleteProgram(shader_program);
         shader_program = 0;
     }
+    else
+    {
+        program_cache::Store(cache_key, shader_program);
+    }
 
     return shader_program;
 }
 
 GlfwModule::GlfwModule()
+    : GlfwModule(RunOptions{})
+{
+}
+
+GlfwModule::GlfwModule(RunOptions const& options)
+    : options_(options)
 {
+    if (!options_.trace_path.empty())
+    {
+        profiler::Start();
+    }
+
+    glfw_initialized_ = InitializeGlfw();
+    if (!glfw_initialized_)
+    {
+        return;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
-    glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -90,16 +124,86 @@ GlfwModule::GlfwModule()
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+
+    program_cache::SetDirectory(options_.shader_cache_dir);
+
+    if (options_.update_rate > 0.0)
+    {
+        SetFixedUpdateRate(options_.update_rate);
+    }
+
+    if (options_.headless)
+    {
+        // 窗口只用来承载 GL 上下文，实际渲染到离屏 FBO
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 }
 
 GlfwModule::~GlfwModule()
 {
-    glfwTerminate();
+    if (window_)
+    {
+        recorder_.Stop();
+        gpu_timer_.Release();
+        DestroyOffscreenTarget();
+        glfwDestroyWindow(window_);
+        window_ = nullptr;
+    }
+
+    if (glfw_initialized_)
+    {
+        glfwTerminate();
+    }
+
+    if (!options_.trace_path.empty())
+    {
+        profiler::Stop();
+        if (!profiler::WriteChromeTrace(options_.trace_path))
+        {
+            ShowErrorMessage("Failed to write trace file: " + options_.trace_path);
+        }
+    }
+}
+
+bool GlfwModule::InitializeGlfw()
+{
+    if (glfwInit())
+    {
+        return true;
+    }
+
+    if (!options_.headless)
+    {
+        ShowErrorMessage("Failed to initialize GLFW");
+        return false;
+    }
+
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+    // 没有显示器（没有 X11/Wayland）时退回 null 平台，用 OSMesa (llvmpipe) 创建纯软件上下文
+    if (glfwPlatformSupported(GLFW_PLATFORM_NULL))
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        if (glfwInit())
+        {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+            return true;
+        }
+    }
+#endif
+
+    ShowErrorMessage("Failed to initialize GLFW for headless rendering");
+    return false;
 }
 
 bool GlfwModule::InitializeContext()
 {
+    PROFILE_ZONE("GlfwModule::InitializeContext");
     ASSERT(!window_);
+    if (!glfw_initialized_)
+    {
+        return false;
+    }
+
     // glfw window creation
     // --------------------
     window_ = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, nullptr, nullptr);
@@ -110,7 +214,12 @@ bool GlfwModule::InitializeContext()
     }
 
     glfwMakeContextCurrent(window_);
+    glfwSetWindowUserPointer(window_, this);
     glfwSetFramebufferSizeCallback(window_, FramebufferSizeCallback);
+    glfwSetWindowRefreshCallback(window_, WindowRefreshCallback);
+    glfwSetKeyCallback(window_, KeyCallback);
+    glfwSetMouseButtonCallback(window_, MouseButtonCallback);
+    glfwSetScrollCallback(window_, ScrollCallback);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -119,33 +228,283 @@ bool GlfwModule::InitializeContext()
         ShowErrorMessage("Failed to initialize GLAD");
         return false;
     }
+    // 新的上下文，之前缓存的状态都不再成立
+    GLStateCache::Current().Invalidate();
+
+    if (options_.headless && !CreateOffscreenTarget())
+    {
+        ShowErrorMessage("Failed to create offscreen framebuffer");
+        return false;
+    }
+
+    // 显式设置交换间隔，不依赖驱动的默认值
+    VsyncMode vsync = ApplyVsyncMode(options_.vsync.value_or(VsyncMode::On));
+    if (options_.vsync == VsyncMode::Adaptive && vsync != VsyncMode::Adaptive)
+    {
+        ShowErrorMessage(std::string("Adaptive vsync is not supported, using ") + VsyncModeName(vsync));
+    }
+    pacer_.SetTargetFps(options_.fps_cap);
+    pacer_.SetSpinMargin(options_.spin_margin_ms);
+
+    if (options_.gpu_timing)
+    {
+        gpu_timer_.Enable();
+    }
+
+    if (!options_.record_path.empty())
+    {
+        int width = 0;
+        int height = 0;
+        GetFramebufferSize(width, height);
+        if (!recorder_.Start(options_.record_path, width, height, static_cast<int>(DEFAULT_UPDATE_RATE)))
+        {
+            ShowErrorMessage("Failed to start recording: " + options_.record_path);
+        }
+    }
 
     return true;
 }
 
 void GlfwModule::RunMessageLoop(std::function<void(void)> render)
 {
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window_))
-    {
-        ProcessInput();
-
-        // render
-        // ------
-        glClearColor(bkg_color_[0], bkg_color_[1], bkg_color_[2], 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
+    RunMessageLoop([&render] {
         if (render)
         {
             render();
         }
+    });
+}
+
+void GlfwModule::BeginLoop()
+{
+    if (options_.bench)
+    {
+        frame_stats_.Reserve(options_.frame_count);
+    }
+    last_frame_start_ = Clock::now();
+}
+
+void GlfwModule::EndLoop()
+{
+    if (recorder_.IsRecording())
+    {
+        recorder_.Stop();
+        std::cout << "Recorded " << recorder_.FramesWritten() << " frames to " << options_.record_path << "\n";
+    }
+
+    if (options_.headless)
+    {
+        glFinish();
+    }
+
+    if (options_.bench)
+    {
+        ReportBenchmark();
+        GLStateCache::Current().WriteJson(std::cout);
+    }
+
+    if (gpu_timer_.IsEnabled())
+    {
+        gpu_timer_.WriteJson(std::cout);
+    }
+
+    if (pacer_.IsLimited())
+    {
+        pacer_.WriteJson(std::cout);
+    }
+}
+
+bool GlfwModule::BeginFrame()
+{
+    if (ShouldClose())
+    {
+        return false;
+    }
+
+    if (IsOnDemand() && !WaitForRedraw())
+    {
+        return false;
+    }
+
+    frame_start_ = Clock::now();
+    frame_delta_ = std::chrono::duration<double>(frame_start_ - last_frame_start_).count();
+    last_frame_start_ = frame_start_;
+    if (!options_.capture_path.empty())
+    {
+        // 截图对比需要每次运行得到完全相同的画面，用固定的帧间隔代替真实时间
+        frame_delta_ = fixed_update_step_ > 0.0 ? fixed_update_step_ : 1.0 / DEFAULT_UPDATE_RATE;
+    }
+    frame_begin_ns_ = profiler::IsEnabled() ? profiler::Now() : 0;
+
+    ProcessInput();
+    return true;
+}
+
+void GlfwModule::BeginRender()
+{
+    render_begin_ns_ = profiler::IsEnabled() ? profiler::Now() : 0;
+
+    // render
+    // ------
+    gpu_timer_.BeginFrame();
+    GpuScope scope{gpu_timer_, "clear"};
+    glClearColor(bkg_color_[0], bkg_color_[1], bkg_color_[2], 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void GlfwModule::EndFrame()
+{
+    gpu_timer_.EndFrame();
+    if (profiler::IsEnabled())
+    {
+        profiler::RecordZone("Render", render_begin_ns_, profiler::Now());
+    }
+
+    if (!options_.capture_path.empty() && IsLastFrame())
+    {
+        CaptureFrame();
+    }
+    recorder_.CaptureFrame();
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window_);
+    // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+    // -------------------------------------------------------------------------------
+    {
+        PROFILE_ZONE("SwapBuffers");
+        if (options_.headless)
+        {
+            glFlush();
+        }
+        else
+        {
+            glfwSwapBuffers(window_);
+        }
+    }
+    {
+        PROFILE_ZONE("PollEvents");
         glfwPollEvents();
     }
+
+    if (options_.bench && frame_index_ >= options_.warmup_frames)
+    {
+        frame_stats_.Add(std::chrono::duration<double, std::milli>(Clock::now() - frame_start_).count());
+    }
+    ++frame_index_;
+
+    if (profiler::IsEnabled())
+    {
+        profiler::RecordZone("Frame", frame_begin_ns_, profiler::Now());
+    }
+
+    // 帧率限制的等待不计入帧时间
+    {
+        PROFILE_ZONE("FramePacer::Wait");
+        pacer_.Wait();
+    }
+}
+
+void GlfwModule::SetFixedUpdateRate(double hz)
+{
+    fixed_update_step_ = hz > 0.0 ? 1.0 / hz : 0.0;
+}
+
+void GlfwModule::SetRedrawMode(RedrawMode mode)
+{
+    redraw_mode_ = mode;
+    Invalidate();
+}
+
+void GlfwModule::Invalidate()
+{
+    redraw_requested_.store(true);
+    if (window_)
+    {
+        // 唤醒可能阻塞在 glfwWaitEvents 上的主线程
+        glfwPostEmptyEvent();
+    }
+}
+
+void GlfwModule::SetAnimating(bool animating)
+{
+    animating_ = animating;
+    if (animating_)
+    {
+        Invalidate();
+    }
+}
+
+bool GlfwModule::IsOnDemand() const
+{
+    return redraw_mode_ == RedrawMode::OnDemand && !options_.headless && !options_.bench &&
+           options_.frame_count <= 0 && options_.capture_path.empty() && options_.record_path.empty();
+}
+
+// 阻塞到有重绘请求为止，窗口要关闭时返回 false
+bool GlfwModule::WaitForRedraw()
+{
+    if (animating_ || redraw_requested_.exchange(false))
+    {
+        return true;
+    }
+
+    PROFILE_ZONE("WaitEvents");
+    while (!redraw_requested_.exchange(false))
+    {
+        glfwWaitEvents();
+        ProcessInput();
+        if (glfwWindowShouldClose(window_))
+        {
+            return false;
+        }
+    }
+
+    // 空闲期间不算作帧间隔，避免醒来后一次补跑大量 Update
+    last_frame_start_ = Clock::now();
+    return true;
+}
+
+void GlfwModule::GetFramebufferSize(int& width, int& height) const
+{
+    width = WINDOW_WIDTH;
+    height = WINDOW_HEIGHT;
+    if (!options_.headless)
+    {
+        glfwGetFramebufferSize(window_, &width, &height);
+    }
+}
+
+void GlfwModule::GetCursorPosition(double& x, double& y) const
+{
+    x = 0.0;
+    y = 0.0;
+    if (options_.headless)
+    {
+        return;
+    }
+
+    // 光标是窗口坐标，高 DPI 屏幕上和帧缓冲像素不是 1:1
+    glfwGetCursorPos(window_, &x, &y);
+    int window_width = 0;
+    int window_height = 0;
+    int width = 0;
+    int height = 0;
+    glfwGetWindowSize(window_, &window_width, &window_height);
+    glfwGetFramebufferSize(window_, &width, &height);
+    if (window_width > 0 && window_height > 0)
+    {
+        x *= static_cast<double>(width) / window_width;
+        y *= static_cast<double>(height) / window_height;
+    }
+}
+
+bool GlfwModule::IsMouseButtonPressed(int button) const
+{
+    return !options_.headless && glfwGetMouseButton(window_, button) == GLFW_PRESS;
+}
+
+std::string GlfwModule::GetAssetPath(std::string const& relative_path) const
+{
+    std::string const& asset_dir = options_.asset_dir.empty() ? GetExecutableDir() + "/assets" : options_.asset_dir;
+    return (std::filesystem::path(asset_dir) / relative_path).string();
 }
 
 void GlfwModule::SetBackgroundColor(float red, float green, float blue)
@@ -159,7 +518,116 @@ void GlfwModule::FramebufferSizeCallback(GLFWwindow* window, int width, int heig
 {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    GLStateCache::Current().Viewport(0, 0, width, height);
+    InvalidateWindow(window);
+}
+
+void GlfwModule::WindowRefreshCallback(GLFWwindow* window)
+{
+    InvalidateWindow(window);
+}
+
+void GlfwModule::KeyCallback(GLFWwindow* window, int /*key*/, int /*scancode*/, int /*action*/, int /*mods*/)
+{
+    InvalidateWindow(window);
+}
+
+void GlfwModule::MouseButtonCallback(GLFWwindow* window, int /*button*/, int /*action*/, int /*mods*/)
+{
+    InvalidateWindow(window);
+}
+
+void GlfwModule::ScrollCallback(GLFWwindow* window, double /*x_offset*/, double y_offset)
+{
+    if (auto* module = static_cast<GlfwModule*>(glfwGetWindowUserPointer(window)))
+    {
+        module->scroll_offset_ += y_offset;
+    }
+    InvalidateWindow(window);
+}
+
+void GlfwModule::InvalidateWindow(GLFWwindow* window)
+{
+    if (auto* module = static_cast<GlfwModule*>(glfwGetWindowUserPointer(window)))
+    {
+        module->redraw_requested_.store(true);
+    }
+}
+
+// headless: create a framebuffer object of the window size and keep it bound for the whole run
+// ---------------------------------------------------------------------------------------------
+bool GlfwModule::CreateOffscreenTarget()
+{
+    glGenFramebuffers(1, &offscreen_fbo_);
+    GLStateCache::Current().BindFramebuffer(GL_FRAMEBUFFER, offscreen_fbo_);
+
+    glGenRenderbuffers(1, &offscreen_color_);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreen_color_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen_color_);
+
+    glGenRenderbuffers(1, &offscreen_depth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreen_depth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreen_depth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLStateCache::Current().Viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void GlfwModule::DestroyOffscreenTarget()
+{
+    if (offscreen_fbo_)
+    {
+        GLStateCache::Current().BindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &offscreen_fbo_);
+        offscreen_fbo_ = 0;
+    }
+    if (offscreen_color_)
+    {
+        glDeleteRenderbuffers(1, &offscreen_color_);
+        offscreen_color_ = 0;
+    }
+    if (offscreen_depth_)
+    {
+        glDeleteRenderbuffers(1, &offscreen_depth_);
+        offscreen_depth_ = 0;
+    }
+}
+
+bool GlfwModule::ShouldClose() const
+{
+    if (options_.frame_count > 0 && frame_index_ >= options_.warmup_frames + options_.frame_count)
+    {
+        return true;
+    }
+    return glfwWindowShouldClose(window_);
+}
+
+bool GlfwModule::IsLastFrame() const
+{
+    return options_.frame_count > 0 && frame_index_ + 1 == options_.warmup_frames + options_.frame_count;
+}
+
+// 在交换缓冲之前读回，windowed 模式下读的是后缓冲
+void GlfwModule::CaptureFrame()
+{
+    PROFILE_ZONE("CaptureFrame");
+    int width = 0;
+    int height = 0;
+    GetFramebufferSize(width, height);
+
+    if (!WritePng(options_.capture_path, ReadFramebuffer(width, height)))
+    {
+        ShowErrorMessage("Failed to write capture: " + options_.capture_path);
+    }
+}
+
+void GlfwModule::ReportBenchmark()
+{
+    std::string name = std::filesystem::path(GetExecutablePath()).stem().string();
+    WriteFrameStatsJson(std::cout, name, frame_stats_.Summarize());
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
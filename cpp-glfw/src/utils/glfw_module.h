@@ -1,10 +1,20 @@
 #pragma once
 
+#include "command_line.h"
+#include "frame_recorder.h"
+#include "frame_stats.h"
 #include "gl_include.h"
+#include "gpu_timer.h"
+#include "profiler.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace utils {
 
@@ -12,6 +22,19 @@ constexpr int WINDOW_WIDTH = 800;
 constexpr int WINDOW_HEIGHT = 600;
 constexpr char WINDOW_TITLE[] = "LearnOpenGL";
 
+enum class RedrawMode
+{
+    // 每次循环都重绘
+    Continuous,
+    // 只在 Invalidate()、窗口尺寸变化、需要重绘（expose）或输入时重绘，其余时间阻塞在 glfwWaitEvents 上
+    OnDemand,
+};
+
+// 默认的模拟频率（Hz）
+constexpr double DEFAULT_UPDATE_RATE = 60.0;
+// 单帧最多追赶的模拟时间（秒），避免卡顿之后 Update 越积越多
+constexpr double MAX_UPDATE_CATCH_UP = 0.25;
+
 void ShowErrorMessage(char const* msg);
 
 inline void ShowErrorMessage(std::string const& msg)
@@ -27,20 +50,212 @@ class GlfwModule
 {
 public:
     GlfwModule();
+    explicit GlfwModule(RunOptions const& options);
     ~GlfwModule();
 
     bool InitializeContext();
+
+    // 兼容接口，每帧经过一次 std::function 间接调用
     void RunMessageLoop(std::function<void(void)> render);
 
+    // 渲染回调直接内联进循环，传入 lambda 时会优先匹配这个版本
+    template <typename Render>
+    void RunMessageLoop(Render&& render);
+
+    // 以 App 对象驱动循环，所有钩子都是可选的，按存在与否在编译期展开为直接调用:
+    //   bool Init() / void Init()   进入循环前调用一次，返回 false 时不进入循环
+    //   void Update(double dt)      以固定步长调用（见 SetFixedUpdateRate），一帧内可能调用 0 次或多次
+    //   void Render(float alpha)    每帧调用一次，调用前已清屏；alpha 为两次 Update 之间的插值系数 [0, 1)
+    //   void Render()               不需要插值时可以省略参数
+    //   void Shutdown()             退出循环后调用一次
+    template <typename App>
+    bool Run(App& app);
+
+    // Update 的频率，与渲染帧率无关；hz <= 0 表示每帧调用一次 Update，dt 为实际帧间隔
+    void SetFixedUpdateRate(double hz);
+
+    // 距上一帧开始的时间（秒）
+    double GetFrameDelta() const
+    {
+        return frame_delta_;
+    }
+
     void SetBackgroundColor(float red, float green, float blue);
 
+    // headless、benchmark、截图和录制时总是连续重绘
+    void SetRedrawMode(RedrawMode mode);
+    // 请求重绘一帧，可以在任意线程调用
+    void Invalidate();
+    // OnDemand 模式下动画进行中需要连续重绘
+    void SetAnimating(bool animating);
+
+    bool IsHeadless() const
+    {
+        return options_.headless;
+    }
+
+    // 指定了 --capture，截图应该是确定的，异步加载的资源要在进入循环前准备好
+    bool IsCapturing() const
+    {
+        return !options_.capture_path.empty();
+    }
+
+    // 资源文件路径，relative_path 相对于资源目录（--assets）
+    std::string GetAssetPath(std::string const& relative_path) const;
+
+    bool IsHotReloadEnabled() const
+    {
+        return options_.hot_reload;
+    }
+
+    // 渲染回调里可以用 GpuScope 打开命名的 GPU 计时区间
+    GpuTimer& GetGpuTimer()
+    {
+        return gpu_timer_;
+    }
+
+    // 当前绘制目标的尺寸，headless 时是离屏目标的尺寸
+    void GetFramebufferSize(int& width, int& height) const;
+
+    // 光标位置，已经换算成帧缓冲像素（原点在左上角）；headless 时总是 (0, 0)
+    void GetCursorPosition(double& x, double& y) const;
+
+    bool IsMouseButtonPressed(int button) const;
+
+    // 取出上次调用以来滚轮的纵向累计偏移
+    double TakeScrollOffset()
+    {
+        return std::exchange(scroll_offset_, 0.0);
+    }
+
 private:
+    using Clock = std::chrono::steady_clock;
+
+    // 循环的各个阶段，模板循环只负责把它们和应用的回调串起来
+    void BeginLoop();
+    void EndLoop();
+    bool BeginFrame();
+    void BeginRender();
+    void EndFrame();
+
     static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
+    static void WindowRefreshCallback(GLFWwindow* window);
+    static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+    static void ScrollCallback(GLFWwindow* window, double x_offset, double y_offset);
+    static void InvalidateWindow(GLFWwindow* window);
+    bool IsOnDemand() const;
+    bool WaitForRedraw();
+    bool InitializeGlfw();
+    bool CreateOffscreenTarget();
+    void DestroyOffscreenTarget();
+    bool ShouldClose() const;
     void ProcessInput();
+    void ReportBenchmark();
+    bool IsLastFrame() const;
+    void CaptureFrame();
 
 private:
+    RunOptions options_;
+    bool glfw_initialized_ = false;
     GLFWwindow* window_ = nullptr;
+    // headless 模式下的离屏渲染目标
+    GLuint offscreen_fbo_ = 0;
+    GLuint offscreen_color_ = 0;
+    GLuint offscreen_depth_ = 0;
+    int frame_index_ = 0;
+    Clock::time_point frame_start_{};
+    Clock::time_point last_frame_start_{};
+    double frame_delta_ = 0.0;
+    // 固定步长模拟
+    double fixed_update_step_ = 1.0 / DEFAULT_UPDATE_RATE;
+    double update_accumulator_ = 0.0;
+    int64_t frame_begin_ns_ = 0;
+    int64_t render_begin_ns_ = 0;
+    FrameStats frame_stats_;
+    GpuTimer gpu_timer_;
+    FrameRecorder recorder_;
+    FramePacer pacer_;
     std::array<GLfloat, 3> bkg_color_{};
+    RedrawMode redraw_mode_ = RedrawMode::Continuous;
+    std::atomic<bool> redraw_requested_{true};
+    bool animating_ = false;
+    double scroll_offset_ = 0.0;
 };
 
+template <typename Render>
+void GlfwModule::RunMessageLoop(Render&& render)
+{
+    BeginLoop();
+    while (BeginFrame())
+    {
+        BeginRender();
+        render();
+        EndFrame();
+    }
+    EndLoop();
+}
+
+template <typename App>
+bool GlfwModule::Run(App& app)
+{
+    if constexpr (requires { app.Init(); })
+    {
+        if constexpr (std::is_same_v<decltype(app.Init()), bool>)
+        {
+            if (!app.Init())
+            {
+                return false;
+            }
+        }
+        else
+        {
+            app.Init();
+        }
+    }
+
+    BeginLoop();
+    update_accumulator_ = 0.0;
+    while (BeginFrame())
+    {
+        float alpha = 0.0f;
+        if constexpr (requires { app.Update(0.0); })
+        {
+            PROFILE_ZONE("Update");
+            if (fixed_update_step_ > 0.0)
+            {
+                update_accumulator_ += std::min(frame_delta_, MAX_UPDATE_CATCH_UP);
+                while (update_accumulator_ >= fixed_update_step_)
+                {
+                    app.Update(fixed_update_step_);
+                    update_accumulator_ -= fixed_update_step_;
+                }
+                alpha = static_cast<float>(update_accumulator_ / fixed_update_step_);
+            }
+            else
+            {
+                app.Update(frame_delta_);
+            }
+        }
+
+        BeginRender();
+        if constexpr (requires { app.Render(alpha); })
+        {
+            app.Render(alpha);
+        }
+        else if constexpr (requires { app.Render(); })
+        {
+            app.Render();
+        }
+        EndFrame();
+    }
+    EndLoop();
+
+    if constexpr (requires { app.Shutdown(); })
+    {
+        app.Shutdown();
+    }
+    return true;
+}
+
 } // namespace utils
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "gpu_timer.h"
+
+#include <cassert>
+#include <cstring>
+
+#define ASSERT assert
+
+namespace utils {
+
+namespace {
+
+constexpr int FRAME_SCOPE_ID = -1;
+
+double NanosecondsToMs(GLuint64 begin, GLuint64 end)
+{
+    return end > begin ? static_cast<double>(end - begin) / 1.0e6 : 0.0;
+}
+
+} // namespace
+
+void GpuTimer::Enable()
+{
+    enabled_ = true;
+}
+
+void GpuTimer::Release()
+{
+    for (auto& slot : slots_)
+    {
+        if (!slot.queries.empty())
+        {
+            glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+            slot.queries.clear();
+        }
+        slot.markers.clear();
+        slot.used_queries = 0;
+        slot.pending = false;
+    }
+}
+
+void GpuTimer::BeginFrame()
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    ASSERT(!in_frame_);
+
+    FrameSlot& slot = slots_[frame_index_ % FRAME_LATENCY];
+    if (slot.pending)
+    {
+        CollectResults(slot);
+    }
+
+    slot.used_queries = 0;
+    slot.markers.clear();
+    in_frame_ = true;
+
+    Marker frame;
+    frame.scope_id = FRAME_SCOPE_ID;
+    frame.begin_query = AllocateQuery(slot);
+    frame.end_query = -1;
+    glQueryCounter(slot.queries[frame.begin_query], GL_TIMESTAMP);
+    slot.markers.push_back(frame);
+}
+
+void GpuTimer::EndFrame()
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    ASSERT(in_frame_);
+
+    // 帧的结束时间戳是最后一个查询，它就绪时本帧所有查询都已就绪
+    FrameSlot& slot = slots_[frame_index_ % FRAME_LATENCY];
+    Marker& frame = slot.markers.front();
+    frame.end_query = AllocateQuery(slot);
+    glQueryCounter(slot.queries[frame.end_query], GL_TIMESTAMP);
+
+    slot.pending = true;
+    in_frame_ = false;
+    ++frame_index_;
+}
+
+int GpuTimer::BeginScope(const char* name)
+{
+    if (!enabled_ || !in_frame_)
+    {
+        return -1;
+    }
+
+    FrameSlot& slot = slots_[frame_index_ % FRAME_LATENCY];
+    Marker marker;
+    marker.scope_id = FindOrAddScope(name);
+    marker.begin_query = AllocateQuery(slot);
+    marker.end_query = -1;
+    glQueryCounter(slot.queries[marker.begin_query], GL_TIMESTAMP);
+    slot.markers.push_back(marker);
+    return static_cast<int>(slot.markers.size()) - 1;
+}
+
+void GpuTimer::EndScope(int marker)
+{
+    if (!enabled_ || !in_frame_ || marker < 0)
+    {
+        return;
+    }
+
+    FrameSlot& slot = slots_[frame_index_ % FRAME_LATENCY];
+    ASSERT(marker < static_cast<int>(slot.markers.size()));
+    int query = AllocateQuery(slot);
+    slot.markers[marker].end_query = query;
+    glQueryCounter(slot.queries[query], GL_TIMESTAMP);
+}
+
+double GpuTimer::GetFrameAverageMs() const
+{
+    return frame_stats_.count ? frame_stats_.total_ms / static_cast<double>(frame_stats_.count) : 0.0;
+}
+
+double GpuTimer::GetAverageMs(const char* name) const
+{
+    for (auto const& scope : scopes_)
+    {
+        if (strcmp(scope.name, name) == 0)
+        {
+            return scope.count ? scope.total_ms / static_cast<double>(scope.count) : 0.0;
+        }
+    }
+    return 0.0;
+}
+
+void GpuTimer::WriteJson(std::ostream& out) const
+{
+    out << "{\"gpu_frames\":" << frame_stats_.count << ",\"dropped_frames\":" << dropped_frames_
+        << ",\"gpu_ms\":{\"frame\":" << GetFrameAverageMs();
+    for (auto const& scope : scopes_)
+    {
+        out << ",\"" << scope.name << "\":" << (scope.count ? scope.total_ms / static_cast<double>(scope.count) : 0.0);
+    }
+    out << "}}\n";
+}
+
+int GpuTimer::AllocateQuery(FrameSlot& slot)
+{
+    if (slot.used_queries == static_cast<int>(slot.queries.size()))
+    {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        slot.queries.push_back(query);
+    }
+    return slot.used_queries++;
+}
+
+int GpuTimer::FindOrAddScope(const char* name)
+{
+    for (size_t i = 0; i < scopes_.size(); ++i)
+    {
+        if (scopes_[i].name == name || strcmp(scopes_[i].name, name) == 0)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    ScopeStats stats;
+    stats.name = name;
+    scopes_.push_back(stats);
+    return static_cast<int>(scopes_.size()) - 1;
+}
+
+void GpuTimer::CollectResults(FrameSlot& slot)
+{
+    slot.pending = false;
+
+    GLuint last_query = slot.queries[slot.markers.front().end_query];
+    GLint available = 0;
+    glGetQueryObjectiv(last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        // 环的深度仍不足以覆盖 GPU 延迟，丢掉这一帧而不是等待
+        ++dropped_frames_;
+        return;
+    }
+
+    std::vector<GLuint64> timestamps(slot.used_queries);
+    for (int i = 0; i < slot.used_queries; ++i)
+    {
+        glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    for (auto const& marker : slot.markers)
+    {
+        if (marker.end_query < 0)
+        {
+            continue;
+        }
+
+        double elapsed = NanosecondsToMs(timestamps[marker.begin_query], timestamps[marker.end_query]);
+        ScopeStats& stats = (marker.scope_id == FRAME_SCOPE_ID) ? frame_stats_ : scopes_[marker.scope_id];
+        stats.total_ms += elapsed;
+        ++stats.count;
+    }
+}
+
+} // namespace utils
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "gl_include.h"
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace utils {
+
+// 基于 GL_TIMESTAMP 查询的 GPU 计时器
+//
+// 每帧的查询对象放在一个深度为 FRAME_LATENCY 的环里，读结果时对应的帧早已提交，
+// 不会因为等待查询结果而阻塞管线；结果还没就绪的帧直接丢弃。
+// 用时间戳而不是 GL_TIME_ELAPSED，因此 scope 可以嵌套。
+class GpuTimer
+{
+public:
+    static constexpr int FRAME_LATENCY = 4;
+
+    GpuTimer() = default;
+
+    GpuTimer(GpuTimer const&) = delete;
+    GpuTimer& operator=(GpuTimer const&) = delete;
+
+    // 未启用时所有操作都是空操作；Release() 必须在 GL 上下文销毁前调用
+    void Enable();
+    void Release();
+
+    bool IsEnabled() const
+    {
+        return enabled_;
+    }
+
+    void BeginFrame();
+    void EndFrame();
+
+    // name 必须是在整个运行期间都有效的字符串（通常是字面量）
+    int BeginScope(const char* name);
+    void EndScope(int marker);
+
+    double GetFrameAverageMs() const;
+    double GetAverageMs(const char* name) const;
+
+    void WriteJson(std::ostream& out) const;
+
+private:
+    struct Marker
+    {
+        int scope_id = 0;
+        int begin_query = 0;
+        int end_query = 0;
+    };
+
+    struct FrameSlot
+    {
+        std::vector<GLuint> queries;
+        std::vector<Marker> markers;
+        int used_queries = 0;
+        bool pending = false;
+    };
+
+    struct ScopeStats
+    {
+        const char* name = nullptr;
+        double total_ms = 0.0;
+        uint64_t count = 0;
+    };
+
+    int AllocateQuery(FrameSlot& slot);
+    int FindOrAddScope(const char* name);
+    void CollectResults(FrameSlot& slot);
+
+private:
+    bool enabled_ = false;
+    bool in_frame_ = false;
+    int frame_index_ = 0;
+    std::array<FrameSlot, FRAME_LATENCY> slots_;
+    std::vector<ScopeStats> scopes_;
+    ScopeStats frame_stats_;
+    uint64_t dropped_frames_ = 0;
+};
+
+// RAII 形式的 GPU scope
+class GpuScope
+{
+public:
+    GpuScope(GpuTimer& timer, const char* name)
+        : timer_(timer)
+        , marker_(timer.BeginScope(name))
+    {
+    }
+
+    ~GpuScope()
+    {
+        timer_.EndScope(marker_);
+    }
+
+    GpuScope(GpuScope const&) = delete;
+    GpuScope& operator=(GpuScope const&) = delete;
+
+private:
+    GpuTimer& timer_;
+    int marker_ = -1;
+};
+
+} // namespace utils
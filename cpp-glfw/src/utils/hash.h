@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils {
+
+constexpr uint64_t FNV1A64_OFFSET = 14695981039346656037ull;
+
+// FNV-1a 64，用于文件内容去重；传入上一次的结果可以分段计算
+inline uint64_t Fnv1a64(const void* data, size_t size, uint64_t hash = FNV1A64_OFFSET)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace utils
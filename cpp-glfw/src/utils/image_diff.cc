@@ -0,0 +1,81 @@
+#include "image_diff.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+// clang-format off
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define UTILS_DIFF_SSE2 1
+    #include <emmintrin.h>
+#endif
+// clang-format on
+
+namespace utils {
+
+double ImageDiff::Mse() const
+{
+    return count ? static_cast<double>(squared_error) / static_cast<double>(count) : 0.0;
+}
+
+double ImageDiff::Psnr() const
+{
+    double mse = Mse();
+    if (mse == 0.0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+ImageDiff DiffPixels(const uint8_t* a, const uint8_t* b, size_t count)
+{
+    ImageDiff diff;
+    diff.count = count;
+    size_t i = 0;
+
+#if defined(UTILS_DIFF_SSE2)
+    // 每次处理 16 字节：|a-b| 用饱和减法求得，平方和用 madd 累加到 32 位，
+    // 每个 32 位通道每次最多增加 2*255^2，定期归并到 64 位避免溢出
+    constexpr size_t FLUSH_INTERVAL = 8192;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i max_error = zero;
+    while (i + 16 <= count)
+    {
+        __m128i sum32 = zero;
+        size_t end = std::min(count - (count - i) % 16, i + FLUSH_INTERVAL * 16);
+        for (; i < end; i += 16)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            __m128i abs_diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            max_error = _mm_max_epu8(max_error, abs_diff);
+
+            __m128i lo = _mm_unpacklo_epi8(abs_diff, zero);
+            __m128i hi = _mm_unpackhi_epi8(abs_diff, zero);
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(lo, lo));
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(hi, hi));
+        }
+
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sum32);
+        diff.squared_error += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    alignas(16) uint8_t max_lanes[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), max_error);
+    diff.max_error = *std::max_element(max_lanes, max_lanes + 16);
+#endif
+
+    for (; i < count; ++i)
+    {
+        uint32_t d = static_cast<uint32_t>(std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+        diff.squared_error += d * d;
+        diff.max_error = std::max(diff.max_error, d);
+    }
+
+    return diff;
+}
+
+} // namespace utils
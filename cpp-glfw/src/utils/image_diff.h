@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils {
+
+struct ImageDiff
+{
+    uint64_t squared_error = 0;
+    uint32_t max_error = 0;
+    size_t count = 0;
+
+    double Mse() const;
+    // 完全相同时返回 +inf
+    double Psnr() const;
+};
+
+// 逐字节比较两块 8 位像素数据，x86 上使用 SSE2
+ImageDiff DiffPixels(const uint8_t* a, const uint8_t* b, size_t count);
+
+} // namespace utils
@@ -0,0 +1,155 @@
+#include "image_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+
+namespace utils {
+
+namespace {
+
+uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void WriteChunk(std::ofstream& out, const char* type, std::vector<uint8_t> const& data)
+{
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    AppendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    AppendBigEndian(chunk, Crc32(0, chunk.data() + 4, data.size() + 4));
+    out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+} // namespace
+
+Image ReadFramebuffer(int width, int height, int channels)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.pixels.resize(static_cast<size_t>(width) * height * channels);
+
+    GLint pack_alignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &pack_alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, channels == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, image.pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, pack_alignment);
+
+    // GL 的第一行在底部
+    size_t row_size = static_cast<size_t>(width) * channels;
+    std::vector<uint8_t> row(row_size);
+    for (int y = 0; y < height / 2; ++y)
+    {
+        uint8_t* top = image.pixels.data() + y * row_size;
+        uint8_t* bottom = image.pixels.data() + (height - 1 - y) * row_size;
+        memcpy(row.data(), top, row_size);
+        memcpy(top, bottom, row_size);
+        memcpy(bottom, row.data(), row_size);
+    }
+    return image;
+}
+
+bool WritePng(std::string const& path, Image const& image)
+{
+    static const uint8_t COLOR_TYPES[] = {0, 0, 4, 2, 6};
+    if (image.channels < 1 || image.channels > 4 || image.width <= 0 || image.height <= 0)
+    {
+        return false;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+
+    static const uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+
+    std::vector<uint8_t> header;
+    AppendBigEndian(header, static_cast<uint32_t>(image.width));
+    AppendBigEndian(header, static_cast<uint32_t>(image.height));
+    header.push_back(8);
+    header.push_back(COLOR_TYPES[image.channels]);
+    header.push_back(0); // compression
+    header.push_back(0); // filter
+    header.push_back(0); // interlace
+    WriteChunk(out, "IHDR", header);
+
+    // 每行前加过滤类型 0，然后用 stored 块（每块最多 65535 字节）打包成 zlib 流
+    size_t row_size = static_cast<size_t>(image.width) * image.channels;
+    std::vector<uint8_t> raw;
+    raw.reserve((row_size + 1) * image.height);
+    for (int y = 0; y < image.height; ++y)
+    {
+        raw.push_back(0);
+        const uint8_t* row = image.pixels.data() + y * row_size;
+        raw.insert(raw.end(), row, row + row_size);
+    }
+
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+    size_t offset = 0;
+    do
+    {
+        size_t block = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = (offset + block == raw.size());
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(block));
+        zlib.push_back(static_cast<uint8_t>(block >> 8));
+        zlib.push_back(static_cast<uint8_t>(~block));
+        zlib.push_back(static_cast<uint8_t>(~block >> 8));
+        for (size_t i = 0; i < block; ++i)
+        {
+            uint8_t value = raw[offset + i];
+            zlib.push_back(value);
+            adler_a = (adler_a + value) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+        offset += block;
+    } while (offset < raw.size());
+    AppendBigEndian(zlib, (adler_b << 16) | adler_a);
+    WriteChunk(out, "IDAT", zlib);
+
+    WriteChunk(out, "IEND", {});
+    return static_cast<bool>(out);
+}
+
+} // namespace utils
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "gl_include.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// 读回当前绑定的帧缓冲，结果按图片习惯自上而下排列（已翻转 GL 的行序）
+Image ReadFramebuffer(int width, int height, int channels = 3);
+
+// 写出 8 位 PNG（channels 为 1/2/3/4），使用不压缩的 deflate 块，只用于测试图片
+bool WritePng(std::string const& path, Image const& image);
+
+} // namespace utils
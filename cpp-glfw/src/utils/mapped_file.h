@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace utils {
+
+// 告诉系统之后怎样访问映射的数据
+enum class MappedAccess
+{
+    // 打开后马上整个读一遍（例如上传整张纹理），提示系统预读整个文件
+    Sequential,
+    // 只零散地读其中一小部分（例如按需读取瓦片），不预读，读过的页也不带出相邻的页
+    Random,
+};
+
+// 只读映射整个文件，数据按需由系统分页读入，不经过额外的拷贝
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    // 文件不存在、为空或映射失败时返回 false
+    bool Open(std::string const& path, MappedAccess access = MappedAccess::Sequential);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return data_ != nullptr;
+    }
+
+    const uint8_t* Data() const
+    {
+        return data_;
+    }
+
+    size_t Size() const
+    {
+        return size_;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+} // namespace utils
@@ -0,0 +1,407 @@
+#include "mip_generator.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// clang-format off
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define UTILS_MIP_SSE2 1
+    #include <emmintrin.h>
+    // MSVC 不需要编译选项就能使用 AVX 指令；GCC / Clang 用函数级的 target 属性，运行时检测后再调用
+    #if defined(_MSC_VER)
+        #define UTILS_MIP_AVX 1
+        #define UTILS_MIP_AVX_TARGET
+        #include <immintrin.h>
+        #include <intrin.h>
+    #elif defined(__GNUC__)
+        #define UTILS_MIP_AVX 1
+        #define UTILS_MIP_AVX_TARGET __attribute__((target("avx")))
+        #include <immintrin.h>
+    #endif
+#endif
+// clang-format on
+
+namespace utils {
+
+namespace {
+
+constexpr float KAISER_RADIUS = 3.0f;
+constexpr float KAISER_ALPHA = 4.0f;
+constexpr double PI = 3.14159265358979323846;
+// 线性值到 sRGB 字节的查找表精度，暗部一个 sRGB 步长对应的线性值约 1/3300
+constexpr int LINEAR_TO_SRGB_SIZE = 16384;
+
+struct SrgbTables
+{
+    std::array<float, 256> to_linear{};
+    std::array<uint8_t, LINEAR_TO_SRGB_SIZE + 1> to_srgb{};
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            double c = i / 255.0;
+            to_linear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+        }
+        for (int i = 0; i <= LINEAR_TO_SRGB_SIZE; ++i)
+        {
+            double l = static_cast<double>(i) / LINEAR_TO_SRGB_SIZE;
+            double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            to_srgb[i] = static_cast<uint8_t>(std::clamp(static_cast<int>(c * 255.0 + 0.5), 0, 255));
+        }
+    }
+};
+
+SrgbTables const& GetSrgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+// 一维重采样的权重表：目标坐标 i 使用源坐标 first[i] 开始的 count[i] 个样本，权重已归一化
+struct FilterTable
+{
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights;
+    int stride = 0;
+};
+
+double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+        {
+            break;
+        }
+    }
+    return sum;
+}
+
+double Sinc(double x)
+{
+    return x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+}
+
+double KaiserWindowedSinc(double t)
+{
+    double r = t / KAISER_RADIUS;
+    if (r <= -1.0 || r >= 1.0)
+    {
+        return 0.0;
+    }
+    return Sinc(t) * BesselI0(KAISER_ALPHA * std::sqrt(1.0 - r * r)) / BesselI0(KAISER_ALPHA);
+}
+
+FilterTable BuildFilterTable(int source_size, int target_size, MipFilter filter)
+{
+    double scale = static_cast<double>(source_size) / target_size;
+    // Box 覆盖 scale 个源像素，Kaiser 覆盖 ±KAISER_RADIUS 个目标像素
+    double support = filter == MipFilter::Box ? scale * 0.5 : KAISER_RADIUS * scale;
+
+    FilterTable table;
+    table.stride = static_cast<int>(std::ceil(support * 2.0)) + 2;
+    table.first.resize(target_size);
+    table.count.resize(target_size);
+    table.weights.assign(static_cast<size_t>(target_size) * table.stride, 0.0f);
+
+    std::vector<double> weights(table.stride);
+    for (int i = 0; i < target_size; ++i)
+    {
+        double center = (i + 0.5) * scale;
+        int begin = static_cast<int>(std::floor(center - support));
+        int end = static_cast<int>(std::ceil(center + support));
+        std::fill(weights.begin(), weights.end(), 0.0);
+
+        double total = 0.0;
+        int lo = source_size;
+        int hi = -1;
+        for (int s = begin; s < end; ++s)
+        {
+            double w = 0.0;
+            if (filter == MipFilter::Box)
+            {
+                // 源像素 [s, s + 1) 与目标像素 [center - support, center + support) 的重叠长度
+                w = std::max(0.0, std::min(s + 1.0, center + support) - std::max<double>(s, center - support));
+            }
+            else
+            {
+                w = KaiserWindowedSinc((s + 0.5 - center) / scale);
+            }
+            if (w == 0.0)
+            {
+                continue;
+            }
+
+            // 边缘外的样本夹到边缘上
+            int clamped = std::clamp(s, 0, source_size - 1);
+            lo = std::min(lo, clamped);
+            hi = std::max(hi, clamped);
+            weights[static_cast<size_t>(clamped - std::clamp(begin, 0, source_size - 1))] += w;
+            total += w;
+        }
+
+        int base = std::clamp(begin, 0, source_size - 1);
+        table.first[i] = lo;
+        table.count[i] = hi - lo + 1;
+        for (int k = 0; k < table.count[i]; ++k)
+        {
+            table.weights[static_cast<size_t>(i) * table.stride + k] =
+                static_cast<float>(weights[static_cast<size_t>(lo - base + k)] / total);
+        }
+    }
+    return table;
+}
+
+bool HasAvx()
+{
+#if defined(UTILS_MIP_AVX) && defined(_MSC_VER)
+    static const bool has_avx = [] {
+        int info[4];
+        __cpuid(info, 1);
+        // AVX + OSXSAVE，并且系统保存 YMM 寄存器
+        return (info[2] & (1 << 28)) && (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    }();
+    return has_avx;
+#elif defined(UTILS_MIP_AVX)
+    static const bool has_avx = __builtin_cpu_supports("avx");
+    return has_avx;
+#else
+    return false;
+#endif
+}
+
+#if defined(UTILS_MIP_AVX)
+UTILS_MIP_AVX_TARGET void AccumulateRowAvx(float* dst, const float* src, float weight, size_t count)
+{
+    __m256 w = _mm256_set1_ps(weight);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), w));
+        _mm256_storeu_ps(dst + i, sum);
+    }
+    for (; i < count; ++i)
+    {
+        dst[i] += src[i] * weight;
+    }
+}
+#endif
+
+// dst += src * weight
+void AccumulateRow(float* dst, const float* src, float weight, size_t count, bool use_avx)
+{
+#if defined(UTILS_MIP_AVX)
+    if (use_avx)
+    {
+        AccumulateRowAvx(dst, src, weight, count);
+        return;
+    }
+#endif
+    size_t i = 0;
+#if defined(UTILS_MIP_SSE2)
+    __m128 w = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), w)));
+    }
+#endif
+    (void)use_avx;
+    for (; i < count; ++i)
+    {
+        dst[i] += src[i] * weight;
+    }
+}
+
+// 每个像素 4 个 float，横向滤波一行
+void FilterRowHorizontal(float* dst, const float* src, FilterTable const& table)
+{
+    int target_width = static_cast<int>(table.first.size());
+    for (int x = 0; x < target_width; ++x)
+    {
+        const float* weights = &table.weights[static_cast<size_t>(x) * table.stride];
+        const float* pixel = src + static_cast<size_t>(table.first[x]) * 4;
+#if defined(UTILS_MIP_SSE2)
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < table.count[x]; ++k)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixel + k * 4), _mm_set1_ps(weights[k])));
+        }
+        _mm_storeu_ps(dst + static_cast<size_t>(x) * 4, sum);
+#else
+        float sum[4] = {};
+        for (int k = 0; k < table.count[x]; ++k)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                sum[c] += pixel[k * 4 + c] * weights[k];
+            }
+        }
+        std::copy(sum, sum + 4, dst + static_cast<size_t>(x) * 4);
+#endif
+    }
+}
+
+struct FloatImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> pixels;
+};
+
+FloatImage Downsample(FloatImage const& source, MipFilter filter, bool use_avx)
+{
+    FloatImage target;
+    target.width = std::max(1, source.width / 2);
+    target.height = std::max(1, source.height / 2);
+    target.pixels.resize(static_cast<size_t>(target.width) * target.height * 4);
+
+    FilterTable rows = BuildFilterTable(source.height, target.height, filter);
+    FilterTable columns = BuildFilterTable(source.width, target.width, filter);
+
+    // 先纵向把若干源行合成一行（连续内存，适合宽向量），再横向滤波
+    size_t row_floats = static_cast<size_t>(source.width) * 4;
+    std::vector<float> temp(row_floats);
+    for (int y = 0; y < target.height; ++y)
+    {
+        std::fill(temp.begin(), temp.end(), 0.0f);
+        const float* weights = &rows.weights[static_cast<size_t>(y) * rows.stride];
+        for (int k = 0; k < rows.count[y]; ++k)
+        {
+            const float* row = &source.pixels[static_cast<size_t>(rows.first[y] + k) * row_floats];
+            AccumulateRow(temp.data(), row, weights[k], row_floats, use_avx);
+        }
+        FilterRowHorizontal(&target.pixels[static_cast<size_t>(y) * target.width * 4], temp.data(), columns);
+    }
+    return target;
+}
+
+int AlphaChannel(int channels)
+{
+    return channels == 2 || channels == 4 ? channels - 1 : -1;
+}
+
+FloatImage ToFloat(const uint8_t* pixels, int width, int height, int channels, MipOptions const& options)
+{
+    SrgbTables const& tables = GetSrgbTables();
+    int alpha_channel = AlphaChannel(channels);
+    bool premultiply = options.premultiplied_alpha && alpha_channel >= 0;
+
+    FloatImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(static_cast<size_t>(width) * height * 4, 0.0f);
+    size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t* in = pixels + i * channels;
+        float* out = &image.pixels[i * 4];
+        float alpha = alpha_channel >= 0 ? in[alpha_channel] / 255.0f : 1.0f;
+        for (int c = 0; c < channels; ++c)
+        {
+            if (c == alpha_channel)
+            {
+                out[c] = alpha;
+                continue;
+            }
+            float value = options.srgb ? tables.to_linear[in[c]] : in[c] / 255.0f;
+            out[c] = premultiply ? value * alpha : value;
+        }
+    }
+    return image;
+}
+
+void ToBytes(FloatImage const& image, int channels, MipOptions const& options, MipLevel& level)
+{
+    SrgbTables const& tables = GetSrgbTables();
+    int alpha_channel = AlphaChannel(channels);
+    bool premultiplied = options.premultiplied_alpha && alpha_channel >= 0;
+
+    level.width = image.width;
+    level.height = image.height;
+    size_t count = static_cast<size_t>(image.width) * image.height;
+    level.pixels.resize(count * channels);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* in = &image.pixels[i * 4];
+        uint8_t* out = &level.pixels[i * channels];
+        float alpha = alpha_channel >= 0 ? std::clamp(in[alpha_channel], 0.0f, 1.0f) : 1.0f;
+        // 完全透明的像素颜色没有意义，置 0
+        float unpremultiply = premultiplied ? (alpha > 0.0f ? 1.0f / alpha : 0.0f) : 1.0f;
+        for (int c = 0; c < channels; ++c)
+        {
+            if (c == alpha_channel)
+            {
+                out[c] = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+                continue;
+            }
+            float value = std::clamp(in[c] * unpremultiply, 0.0f, 1.0f);
+            out[c] = options.srgb ? tables.to_srgb[static_cast<size_t>(value * LINEAR_TO_SRGB_SIZE + 0.5f)]
+                                  : static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+} // namespace
+
+int MipLevelCount(int width, int height)
+{
+    int count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        ++count;
+    }
+    return count;
+}
+
+std::vector<MipLevel> GenerateMipChain(const uint8_t* pixels, int width, int height, int channels,
+                                       MipOptions const& options, int max_levels)
+{
+    PROFILE_ZONE("GenerateMipChain");
+    std::vector<MipLevel> levels;
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4)
+    {
+        return levels;
+    }
+
+    bool use_avx = HasAvx();
+    int level_count = MipLevelCount(width, height) - 1;
+    if (max_levels > 0)
+    {
+        level_count = std::min(level_count, max_levels);
+    }
+    levels.reserve(static_cast<size_t>(level_count));
+    FloatImage current = ToFloat(pixels, width, height, channels, options);
+    while (static_cast<int>(levels.size()) < level_count)
+    {
+        current = Downsample(current, options.filter, use_avx);
+        levels.emplace_back();
+        ToBytes(current, channels, options, levels.back());
+    }
+    return levels;
+}
+
+MipLevel GenerateMipLevel(const uint8_t* pixels, int width, int height, int channels, MipOptions const& options)
+{
+    PROFILE_ZONE("GenerateMipLevel");
+    MipLevel level;
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4)
+    {
+        return level;
+    }
+
+    FloatImage source = ToFloat(pixels, width, height, channels, options);
+    ToBytes(Downsample(source, options.filter, HasAvx()), channels, options, level);
+    return level;
+}
+
+} // namespace utils
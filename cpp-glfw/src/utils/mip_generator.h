@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace utils {
+
+enum class MipFilter
+{
+    // 按面积平均，每级只看上一级的 2x2（奇数尺寸时按覆盖面积加权）
+    Box,
+    // Kaiser 窗 sinc（半径 3 个目标像素，alpha = 4），更锐利，缩小后的细节不会糊成一片
+    Kaiser,
+};
+
+struct MipOptions
+{
+    MipFilter filter = MipFilter::Box;
+    // 颜色通道按 sRGB 编码：转换到线性空间滤波后再编码回去，缩小后不会变暗（alpha 始终是线性的）
+    bool srgb = false;
+    // 带 alpha 的图片（2 / 4 通道）在预乘空间滤波，透明像素的颜色不会渗到边缘；输出仍是非预乘的
+    bool premultiplied_alpha = false;
+
+    bool operator==(MipOptions const&) const = default;
+};
+
+struct MipLevel
+{
+    int width = 0;
+    int height = 0;
+    // 按 channels 紧密排列
+    std::vector<uint8_t> pixels;
+};
+
+// 包括第 0 级在内的级数
+int MipLevelCount(int width, int height);
+
+// 在 CPU 上生成第 1 级直到 1x1 的各级（不包括第 0 级），每级由上一级缩小得到；max_levels > 0 时最多生成这么多级。
+// 内部以每像素 4 个 float 计算，x86 上使用 SSE，CPU 支持时纵向滤波使用 AVX。
+// 线程安全，可以在多个工作线程上同时为不同的图片调用
+std::vector<MipLevel> GenerateMipChain(const uint8_t* pixels, int width, int height, int channels,
+                                       MipOptions const& options, int max_levels = 0);
+
+// 只生成下一级（宽高减半，向下取整），用法同 GenerateMipChain。
+// 宽高都是偶数时正好是 2:1 缩小，可以把大图切成带重叠边距的块分别缩小后再拼起来
+MipLevel GenerateMipLevel(const uint8_t* pixels, int width, int height, int channels, MipOptions const& options);
+
+} // namespace utils
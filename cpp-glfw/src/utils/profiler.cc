@@ -0,0 +1,162 @@
+#include "profiler.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace utils {
+namespace profiler {
+
+std::atomic<bool> g_enabled{false};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event
+{
+    const char* name = nullptr;
+    int64_t begin_ns = 0;
+    int64_t end_ns = 0;
+};
+
+// 定长的事件块，写满后挂一个新块；已发布的块和事件不会再移动
+struct Chunk
+{
+    static constexpr uint32_t CAPACITY = 4096;
+
+    std::array<Event, CAPACITY> events;
+    std::atomic<uint32_t> count{0};
+    std::atomic<Chunk*> next{nullptr};
+};
+
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(int id)
+        : thread_id(id)
+    {
+    }
+
+    ~ThreadBuffer()
+    {
+        Chunk* chunk = head.next.load(std::memory_order_acquire);
+        while (chunk)
+        {
+            Chunk* next = chunk->next.load(std::memory_order_acquire);
+            delete chunk;
+            chunk = next;
+        }
+    }
+
+    int thread_id = 0;
+    Chunk head;
+    // 只有所属线程访问
+    Chunk* tail = &head;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    Clock::time_point origin = Clock::now();
+};
+
+Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer& GetThreadBuffer()
+{
+    // 缓冲区归注册表所有，线程退出后事件仍然保留到导出
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<int>(registry.buffers.size()) + 1));
+        buffer = registry.buffers.back().get();
+    }
+    return *buffer;
+}
+
+} // namespace
+
+void Start()
+{
+    GetRegistry();
+    g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Stop()
+{
+    g_enabled.store(false, std::memory_order_relaxed);
+}
+
+int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - GetRegistry().origin).count();
+}
+
+void RecordZone(const char* name, int64_t begin_ns, int64_t end_ns)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    Chunk* chunk = buffer.tail;
+    uint32_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == Chunk::CAPACITY)
+    {
+        Chunk* next = new Chunk;
+        chunk->next.store(next, std::memory_order_release);
+        buffer.tail = next;
+        chunk = next;
+        count = 0;
+    }
+
+    chunk->events[count] = Event{name, begin_ns, end_ns};
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+bool WriteChromeTrace(std::string const& path)
+{
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // ts/dur 的单位是微秒
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (auto const& buffer : registry.buffers)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+            << ",\"args\":{\"name\":\"thread " << buffer->thread_id << "\"}}";
+        first = false;
+
+        for (Chunk const* chunk = &buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            uint32_t count = chunk->count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Event const& event = chunk->events[i];
+                out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+                    << ",\"ts\":" << static_cast<double>(event.begin_ns) / 1000.0
+                    << ",\"dur\":" << static_cast<double>(event.end_ns - event.begin_ns) / 1000.0 << "}";
+            }
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace profiler
+} // namespace utils
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace utils {
+
+// 轻量的 CPU 性能打点，导出为 Chrome trace_event JSON（可用 Perfetto / chrome://tracing 查看）
+//
+// 每个线程写自己的事件缓冲区：只有所属线程会追加事件，追加后用 release 语义发布计数，
+// 因此记录事件不需要加锁；只有线程第一次打点（注册缓冲区）和导出时才会用到互斥锁。
+namespace profiler {
+
+void Start();
+void Stop();
+bool WriteChromeTrace(std::string const& path);
+
+// 单调时钟，相对 Start() 的纳秒数
+int64_t Now();
+
+void RecordZone(const char* name, int64_t begin_ns, int64_t end_ns);
+
+extern std::atomic<bool> g_enabled;
+
+inline bool IsEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+} // namespace profiler
+
+// RAII 区间，name 必须在整个运行期间有效（通常是字面量）
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name)
+        : name_(profiler::IsEnabled() ? name : nullptr)
+        , begin_ns_(name_ ? profiler::Now() : 0)
+    {
+    }
+
+    ~ProfileZone()
+    {
+        if (name_)
+        {
+            profiler::RecordZone(name_, begin_ns_, profiler::Now());
+        }
+    }
+
+    ProfileZone(ProfileZone const&) = delete;
+    ProfileZone& operator=(ProfileZone const&) = delete;
+
+private:
+    const char* name_ = nullptr;
+    int64_t begin_ns_ = 0;
+};
+
+} // namespace utils
+
+#define UTILS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define UTILS_PROFILE_CONCAT(a, b) UTILS_PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) ::utils::ProfileZone UTILS_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
@@ -0,0 +1,267 @@
+#include "program_cache.h"
+#include "hash.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// clang-format off
+#if defined(_WIN32)
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+// clang-format on
+
+namespace utils {
+
+namespace program_cache {
+
+namespace {
+
+constexpr char CACHE_MAGIC[4] = {'G', 'L', 'P', 'B'};
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+};
+
+std::string g_directory;
+Stats g_stats;
+
+int CurrentProcessId()
+{
+#if defined(_WIN32)
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+using GetProgramBinaryProc = void(APIENTRYP)(GLuint program, GLsizei buf_size, GLsizei* length,
+                                             GLenum* binary_format, void* binary);
+using ProgramBinaryProc = void(APIENTRYP)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+using ProgramParameteriProc = void(APIENTRYP)(GLuint program, GLenum pname, GLint value);
+
+struct ProgramBinaryProcs
+{
+    GetProgramBinaryProc get_program_binary = nullptr;
+    ProgramBinaryProc program_binary = nullptr;
+    ProgramParameteriProc program_parameteri = nullptr;
+};
+
+// 这三个是 GL 4.1 的函数，3.3 上下文只在有 GL_ARB_get_program_binary 时才能用；
+// 驱动不支持任何二进制格式时（部分软件实现）缓存也没有意义，都返回空
+ProgramBinaryProcs const& GetProgramBinaryProcs()
+{
+    static const ProgramBinaryProcs procs = [] {
+        ProgramBinaryProcs result;
+        if (GLAD_GL_VERSION_4_1)
+        {
+            result = {glad_glGetProgramBinary, glad_glProgramBinary, glad_glProgramParameteri};
+        }
+        else if (glfwExtensionSupported("GL_ARB_get_program_binary"))
+        {
+            result.get_program_binary =
+                reinterpret_cast<GetProgramBinaryProc>(glfwGetProcAddress("glGetProgramBinary"));
+            result.program_binary = reinterpret_cast<ProgramBinaryProc>(glfwGetProcAddress("glProgramBinary"));
+            result.program_parameteri =
+                reinterpret_cast<ProgramParameteriProc>(glfwGetProcAddress("glProgramParameteri"));
+        }
+        if (!result.get_program_binary || !result.program_binary || !result.program_parameteri)
+        {
+            return ProgramBinaryProcs{};
+        }
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0 ? result : ProgramBinaryProcs{};
+    }();
+    return procs;
+}
+
+bool DriverSupportsBinaries()
+{
+    return GetProgramBinaryProcs().program_binary != nullptr;
+}
+
+std::string GetGLString(GLenum name)
+{
+    auto const* value = reinterpret_cast<const char*>(glGetString(name));
+    return value ? value : "";
+}
+
+std::filesystem::path CachePath(uint64_t key)
+{
+    char file_name[32]{};
+    snprintf(file_name, sizeof(file_name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return std::filesystem::path(g_directory) / file_name;
+}
+
+} // namespace
+
+void SetDirectory(std::string directory)
+{
+    g_directory = std::move(directory);
+}
+
+bool IsEnabled()
+{
+    return !g_directory.empty() && DriverSupportsBinaries();
+}
+
+uint64_t MakeKey(std::initializer_list<std::string_view> parts)
+{
+    static const std::string driver =
+        GetGLString(GL_VENDOR) + '\n' + GetGLString(GL_RENDERER) + '\n' + GetGLString(GL_VERSION);
+
+    uint64_t hash = Fnv1a64(driver.data(), driver.size());
+    for (std::string_view part : parts)
+    {
+        // 分隔符保证 {"ab", "c"} 和 {"a", "bc"} 的键不同
+        hash = Fnv1a64(part.data(), part.size(), hash);
+        hash = Fnv1a64("", 1, hash);
+    }
+    return hash;
+}
+
+GLuint Load(uint64_t key)
+{
+    if (!IsEnabled())
+    {
+        return 0;
+    }
+
+    PROFILE_ZONE("program_cache::Load");
+    std::filesystem::path path = CachePath(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        ++g_stats.misses;
+        return 0;
+    }
+
+    CacheHeader header{};
+    std::vector<char> binary;
+    bool valid = in.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                 std::equal(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC), header.magic) &&
+                 header.version == CACHE_VERSION && header.key == key && header.size > 0;
+    if (valid)
+    {
+        binary.resize(header.size);
+        valid = static_cast<bool>(in.read(binary.data(), header.size));
+    }
+    in.close();
+
+    GLuint program = 0;
+    if (valid)
+    {
+        program = glCreateProgram();
+        GetProgramBinaryProcs().program_binary(program, header.format, binary.data(),
+                                               static_cast<GLsizei>(binary.size()));
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (!program)
+    {
+        // 文件损坏或驱动更新后格式不再兼容，删掉它，之后编译成功时会重新写入
+        ++g_stats.rejected;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+
+    ++g_stats.hits;
+    return program;
+}
+
+void PrepareForLink(GLuint program)
+{
+    if (IsEnabled())
+    {
+        GetProgramBinaryProcs().program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void Store(uint64_t key, GLuint program)
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    PROFILE_ZONE("program_cache::Store");
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GetProgramBinaryProcs().get_program_binary(program, length, &length, &format, binary.data());
+    if (length <= 0)
+    {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(g_directory, error);
+
+    CacheHeader header{};
+    std::copy(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC), header.magic);
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.size = static_cast<uint32_t>(length);
+
+    // 先写临时文件再改名，读的一方不会看到半个文件。临时文件名带上进程 id：
+    // 多个进程同时写同一个键时各写各的，最后一次改名生效，不会把别人写了一半的文件改名过去
+    std::filesystem::path path = CachePath(key);
+    std::filesystem::path temp_path = path;
+    temp_path += "." + std::to_string(CurrentProcessId()) + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(binary.data(), length);
+        if (!out)
+        {
+            std::cout << "WARNING: failed to write program cache " << temp_path.string() << "\n";
+            return;
+        }
+    }
+
+    std::filesystem::rename(temp_path, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return;
+    }
+    ++g_stats.stored;
+}
+
+Stats GetStats()
+{
+    return g_stats;
+}
+
+} // namespace program_cache
+
+} // namespace utils
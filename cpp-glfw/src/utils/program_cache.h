@@ -0,0 +1,45 @@
+#pragma once
+
+#include "gl_include.h"
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+// 链接好的 program 的磁盘缓存（glGetProgramBinary / glProgramBinary），跳过启动时的 GLSL 编译。
+//
+// 缓存键是源码、宏定义以及驱动的 GL_VENDOR / GL_RENDERER / GL_VERSION 的哈希，
+// 换驱动或换显卡后自然失效；驱动拒绝加载的二进制会被删除，由调用方重新编译。
+namespace program_cache {
+
+// 缓存目录，空字符串表示禁用（默认禁用，由 GlfwModule 按命令行设置）
+void SetDirectory(std::string directory);
+bool IsEnabled();
+
+// parts 通常是各阶段的源码和宏定义，需要在 GL 上下文创建之后调用
+uint64_t MakeKey(std::initializer_list<std::string_view> parts);
+
+// 命中时返回已链接好的 program，未命中或被驱动拒绝时返回 0
+GLuint Load(uint64_t key);
+
+// 在 glLinkProgram 之前调用，提示驱动保留二进制
+void PrepareForLink(GLuint program);
+
+// program 必须已经链接成功
+void Store(uint64_t key, GLuint program);
+
+struct Stats
+{
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t rejected = 0;
+    uint32_t stored = 0;
+};
+
+Stats GetStats();
+
+} // namespace program_cache
+
+} // namespace utils
@@ -1,77 +1,422 @@
 #include "shader.h"
+#include "gl_state.h"
+#include "profiler.h"
+#include "program_cache.h"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 
 #define ASSERT assert
 
+// GL_KHR_parallel_shader_compile，glad 生成时没有包含扩展，这里手动补上
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace utils {
 
-Shader::Shader(const char* vertex_shader_source, const char* fragment_shader_source)
+namespace {
+
+using MaxShaderCompilerThreadsProc = void(APIENTRYP)(GLuint count);
+
+// sampler / image 的值是单个纹理单元（图像单元）编号
+bool IsOpaqueUniformType(GLenum type)
+{
+    return (type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW) ||
+           (type >= GL_SAMPLER_1D_ARRAY && type <= GL_SAMPLER_CUBE_SHADOW) ||
+           (type >= GL_INT_SAMPLER_1D && type <= GL_UNSIGNED_INT_SAMPLER_BUFFER) ||
+           (type >= GL_SAMPLER_CUBE_MAP_ARRAY && type <= GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY) ||
+           (type >= GL_IMAGE_1D && type <= GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE_ARRAY) ||
+           (type >= GL_SAMPLER_2D_MULTISAMPLE && type <= GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY);
+}
+
+// 影子值需要的 32 位字数，未知类型按 mat4 分配
+uint32_t UniformShadowSize(GLenum type)
 {
+    switch (type)
+    {
+    case GL_FLOAT_VEC2:
+    case GL_INT_VEC2:
+    case GL_UNSIGNED_INT_VEC2:
+    case GL_BOOL_VEC2:
+        return 2;
+    case GL_FLOAT_VEC3:
+    case GL_INT_VEC3:
+    case GL_UNSIGNED_INT_VEC3:
+    case GL_BOOL_VEC3:
+        return 3;
+    case GL_FLOAT_VEC4:
+    case GL_INT_VEC4:
+    case GL_UNSIGNED_INT_VEC4:
+    case GL_BOOL_VEC4:
+    case GL_FLOAT_MAT2:
+        return 4;
+    case GL_FLOAT_MAT2x3:
+    case GL_FLOAT_MAT3x2:
+        return 6;
+    case GL_FLOAT_MAT2x4:
+    case GL_FLOAT_MAT4x2:
+        return 8;
+    case GL_FLOAT_MAT3:
+        return 9;
+    case GL_FLOAT_MAT3x4:
+    case GL_FLOAT_MAT4x3:
+        return 12;
+    case GL_FLOAT_MAT4:
+        return 16;
+    case GL_FLOAT:
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_BOOL:
+        return 1;
+    default:
+        return IsOpaqueUniformType(type) ? 1 : 16;
+    }
+}
+
+} // namespace
+
+bool ParallelShaderCompileSupported()
+{
+    static const bool supported = [] {
+        // ARB 版本的枚举值相同，只是函数名不同
+        const char* proc_name = nullptr;
+        if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+        {
+            proc_name = "glMaxShaderCompilerThreadsKHR";
+        }
+        else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+        {
+            proc_name = "glMaxShaderCompilerThreadsARB";
+        }
+        if (!proc_name)
+        {
+            return false;
+        }
+
+        auto max_threads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress(proc_name));
+        if (max_threads)
+        {
+            // 0xFFFFFFFF 表示由驱动决定线程数
+            max_threads(0xFFFFFFFFu);
+        }
+        return true;
+    }();
+    return supported;
+}
+
+Shader::Shader(const char* vertex_shader_source, const char* fragment_shader_source, ShaderBuild build)
+{
+    PROFILE_ZONE("Shader::Shader");
     ASSERT(vertex_shader_source);
     ASSERT(fragment_shader_source);
 
-    GLuint vertex_shader = 0;
-    GLuint fragment_shader = 0;
+    cache_key_ = program_cache::MakeKey({vertex_shader_source, fragment_shader_source});
+    program_ = program_cache::Load(cache_key_);
+    if (!program_)
+    {
+        SubmitBuild(vertex_shader_source, fragment_shader_source);
+    }
+
+    if (build == ShaderBuild::Immediate || vertex_shader_ == 0)
+    {
+        FinishBuild();
+    }
+}
+
+void Shader::SubmitBuild(const char* vertex_shader_source, const char* fragment_shader_source)
+{
+    // 支持并行编译时要先设置线程数，驱动才会在后台编译
+    ParallelShaderCompileSupported();
 
     // build and compile our shader program
     // ------------------------------------
     // vertex shader
-    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
-    glCompileShader(vertex_shader);
-    CheckCompileErrors(vertex_shader);
+    vertex_shader_ = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader_, 1, &vertex_shader_source, nullptr);
+    glCompileShader(vertex_shader_);
 
     // fragment shader
-    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
-    glCompileShader(fragment_shader);
-    CheckCompileErrors(fragment_shader);
+    fragment_shader_ = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader_, 1, &fragment_shader_source, nullptr);
+    glCompileShader(fragment_shader_);
 
     // link shaders
+    // 链接失败时编译错误也会体现在链接状态里，所以不必先等编译结果
     program_ = glCreateProgram();
-    glAttachShader(program_, vertex_shader);
-    glAttachShader(program_, fragment_shader);
+    glAttachShader(program_, vertex_shader_);
+    glAttachShader(program_, fragment_shader_);
+    program_cache::PrepareForLink(program_);
     glLinkProgram(program_);
-    CheckLinkErrors(program_);
+}
+
+void Shader::FinishBuild()
+{
+    PROFILE_ZONE("Shader::FinishBuild");
+    bool compiled = (vertex_shader_ != 0);
+    if (compiled)
+    {
+        CheckCompileErrors(vertex_shader_);
+        CheckCompileErrors(fragment_shader_);
+        glDeleteShader(vertex_shader_);
+        glDeleteShader(fragment_shader_);
+        vertex_shader_ = 0;
+        fragment_shader_ = 0;
+    }
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    linked_ = CheckLinkErrors(program_);
+    if (linked_)
+    {
+        if (compiled)
+        {
+            program_cache::Store(cache_key_, program_);
+        }
+        ReflectUniforms();
+    }
+    ready_ = true;
+}
+
+bool Shader::IsReady()
+{
+    if (ready_)
+    {
+        return true;
+    }
+
+    if (ParallelShaderCompileSupported())
+    {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program_, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed)
+        {
+            return false;
+        }
+    }
+
+    FinishBuild();
+    return true;
+}
+
+void Shader::Wait()
+{
+    if (!ready_)
+    {
+        FinishBuild();
+    }
 }
 
 Shader::~Shader()
 {
-    glDeleteProgram(program_);
+    glDeleteShader(vertex_shader_);
+    glDeleteShader(fragment_shader_);
+    GLStateCache::Current().DeleteProgram(program_);
     program_ = 0;
 }
 
 void Shader::Use()
 {
-    glUseProgram(program_);
+    Wait();
+    GLStateCache::Current().UseProgram(program_);
 }
 
-void Shader::SetBool(const char* name, GLboolean value)
+void Shader::SetBool(UniformId id, GLboolean value)
 {
-    glUniform1i(glGetUniformLocation(program_, name), static_cast<GLint>(value));
+    SetInt(id, static_cast<GLint>(value));
+}
+
+void Shader::SetInt(UniformId id, GLint value)
+{
+    GLint location = UpdateShadow(id, &value, 1);
+    if (location >= 0)
+    {
+        glUniform1i(location, value);
+    }
 }
 
-void Shader::SetInt(const char* name, GLint value)
+void Shader::SetFloat(UniformId id, GLfloat value)
 {
-    glUniform1i(glGetUniformLocation(program_, name), value);
+    GLint location = UpdateShadow(id, &value, 1);
+    if (location >= 0)
+    {
+        glUniform1f(location, value);
+    }
 }
 
-void Shader::SetFloat(const char* name, GLfloat value)
+void Shader::SetVec2(UniformId id, glm::vec2 const& value)
 {
-    glUniform1f(glGetUniformLocation(program_, name), value);
+    GLint location = UpdateShadow(id, glm::value_ptr(value), 2);
+    if (location >= 0)
+    {
+        glUniform2fv(location, 1, glm::value_ptr(value));
+    }
 }
 
-GLuint Shader::GetUniformLocation(const char* name)
+void Shader::SetVec3(UniformId id, glm::vec3 const& value)
 {
-    return glGetUniformLocation(program_, name);
+    GLint location = UpdateShadow(id, glm::value_ptr(value), 3);
+    if (location >= 0)
+    {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void Shader::SetVec4(UniformId id, glm::vec4 const& value)
+{
+    GLint location = UpdateShadow(id, glm::value_ptr(value), 4);
+    if (location >= 0)
+    {
+        glUniform4fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void Shader::SetMat3(UniformId id, glm::mat3 const& value)
+{
+    GLint location = UpdateShadow(id, glm::value_ptr(value), 9);
+    if (location >= 0)
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+void Shader::SetMat4(UniformId id, glm::mat4 const& value)
+{
+    GLint location = UpdateShadow(id, glm::value_ptr(value), 16);
+    if (location >= 0)
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+GLint Shader::GetUniformLocation(UniformId id) const
+{
+    UniformSlot const* slot = FindUniform(id);
+    return slot ? slot->location : -1;
+}
+
+bool Shader::BindUniformBlock(const char* block_name, GLuint binding)
+{
+    Wait();
+    GLuint index = glGetUniformBlockIndex(program_, block_name);
+    if (index == GL_INVALID_INDEX)
+    {
+        return false;
+    }
+
+    glUniformBlockBinding(program_, index, binding);
+    return true;
+}
+
+// 链接后枚举所有活动 uniform，建立 名字 -> location 的哈希表
+void Shader::ReflectUniforms()
+{
+    uniforms_.clear();
+    shadow_.clear();
+
+    GLint count = 0;
+    GLint max_length = 0;
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // 负载因子不超过 1/2
+    uniforms_.resize(std::bit_ceil(static_cast<size_t>(count) * 2));
+    std::vector<char> name(static_cast<size_t>(max_length) + 1);
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program_, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type,
+                           name.data());
+        std::string uniform_name(name.data(), length);
+        GLint location = glGetUniformLocation(program_, uniform_name.c_str());
+        if (location < 0)
+        {
+            // uniform block 里的成员没有 location
+            continue;
+        }
+
+        // 数组以 "name[0]" 的形式报告，同时登记不带下标的名字
+        if (uniform_name.size() > 3 && uniform_name.ends_with("[0]"))
+        {
+            uniform_name.resize(uniform_name.size() - 3);
+        }
+        InsertUniform(std::move(uniform_name), location, type);
+    }
+}
+
+void Shader::InsertUniform(std::string name, GLint location, GLenum type)
+{
+    uint32_t hash = HashUniformName(name);
+    size_t mask = uniforms_.size() - 1;
+    size_t index = hash & mask;
+    while (!uniforms_[index].name.empty())
+    {
+        index = (index + 1) & mask;
+    }
+
+    UniformSlot& slot = uniforms_[index];
+    slot.name = std::move(name);
+    slot.hash = hash;
+    slot.location = location;
+    slot.type = type;
+    slot.shadow_offset = static_cast<uint32_t>(shadow_.size());
+    slot.shadow_size = UniformShadowSize(type);
+    shadow_.resize(shadow_.size() + slot.shadow_size);
+}
+
+Shader::UniformSlot const* Shader::FindUniform(UniformId id) const
+{
+    if (uniforms_.empty())
+    {
+        return nullptr;
+    }
+
+    size_t mask = uniforms_.size() - 1;
+    for (size_t index = id.hash & mask;; index = (index + 1) & mask)
+    {
+        UniformSlot const& slot = uniforms_[index];
+        if (slot.name.empty())
+        {
+            return nullptr;
+        }
+        if (slot.hash == id.hash && slot.name == id.name)
+        {
+            return &slot;
+        }
+    }
+}
+
+GLint Shader::UpdateShadow(UniformId id, void const* value, uint32_t size)
+{
+    auto* slot = const_cast<UniformSlot*>(FindUniform(id));
+    if (!slot)
+    {
+        return -1;
+    }
+
+    size = std::min(size, slot->shadow_size);
+    uint32_t* shadow = shadow_.data() + slot->shadow_offset;
+    if (slot->has_value && memcmp(shadow, value, size * sizeof(uint32_t)) == 0)
+    {
+        ++skipped_uniform_calls_;
+        return -1;
+    }
+
+    memcpy(shadow, value, size * sizeof(uint32_t));
+    slot->has_value = true;
+    ++issued_uniform_calls_;
+    return slot->location;
 }
 
-void Shader::CheckCompileErrors(GLuint shader)
+bool Shader::CheckCompileErrors(GLuint shader)
 {
     GLint success = 0;
     char info_log[512]{};
@@ -81,9 +426,10 @@ void Shader::CheckCompileErrors(GLuint shader)
         glGetShaderInfoLog(shader, 512, nullptr, info_log);
         std::cout << "ERROR::SHADER::COMPILATION_FAILED\n" << info_log << "\n";
     }
+    return success != GL_FALSE;
 }
 
-void Shader::CheckLinkErrors(GLuint program)
+bool Shader::CheckLinkErrors(GLuint program)
 {
     GLint success = 0;
     char info_log[512]{};
@@ -93,6 +439,7 @@ void Shader::CheckLinkErrors(GLuint program)
         glGetProgramInfoLog(program, 512, nullptr, info_log);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << info_log << std::endl;
     }
+    return success != GL_FALSE;
 }
 
 } // namespace utils
\ No newline at end of file
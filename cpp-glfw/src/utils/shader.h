@@ -1,30 +1,145 @@
 #pragma once
 
 #include "gl_include.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace utils {
 
+// uniform 名字的 FNV-1a 哈希，字面量可以在编译期求值
+constexpr uint32_t HashUniformName(std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : name)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+struct UniformId
+{
+    constexpr UniformId(const char* uniform_name)
+        : name(uniform_name)
+        , hash(HashUniformName(uniform_name))
+    {
+    }
+
+    const char* name;
+    uint32_t hash;
+};
+
+// 保证编译期求哈希: shader.SetMat4("matrix"_uniform, m)
+consteval UniformId operator""_uniform(const char* name, size_t)
+{
+    return UniformId{name};
+}
+
+// 需要在 GL 上下文创建之后调用
+bool ParallelShaderCompileSupported();
+
+enum class ShaderBuild
+{
+    // 构造函数返回时已经编译链接完成
+    Immediate,
+    // 构造函数只提交编译和链接，之后用 IsReady() 轮询或 Wait() 等待。
+    // 驱动支持 GL_KHR_parallel_shader_compile 时在驱动的线程里并行编译，
+    // 否则第一次查询时同步完成（多数驱动本身也会推迟到查询状态时才真正编译）
+    Async,
+};
+
 class Shader
 {
 public:
-    Shader(const char* vertex_shader_source, const char* fragment_shader_source);
+    Shader(const char* vertex_shader_source, const char* fragment_shader_source,
+           ShaderBuild build = ShaderBuild::Immediate);
     ~Shader();
 
     Shader(Shader const&) = delete;
     Shader& operator=(Shader const&) = delete;
 
+    // 还没有完成时会先等待编译完成
     void Use();
-    void SetBool(const char* name, GLboolean value);
-    void SetInt(const char* name, GLint value);
-    void SetFloat(const char* name, GLfloat value);
-    GLuint GetUniformLocation(const char* name);
+
+    // 不阻塞地检查编译链接是否完成，完成时检查错误并反射 uniform
+    bool IsReady();
+    void Wait();
+
+    // 完成之前总是返回 false
+    bool IsLinked() const
+    {
+        return linked_;
+    }
+
+    // 以下 setter 作用于当前使用的 program（先调用 Use()）。
+    // location 在链接后一次性反射得到，值在 CPU 侧有一份影子，与上次设置的值相同时不再调用 glUniform*；
+    // 因此不要绕过 Shader 直接用 glUniform* 修改同一个 uniform。
+    void SetBool(UniformId id, GLboolean value);
+    void SetInt(UniformId id, GLint value);
+    void SetFloat(UniformId id, GLfloat value);
+    void SetVec2(UniformId id, glm::vec2 const& value);
+    void SetVec3(UniformId id, glm::vec3 const& value);
+    void SetVec4(UniformId id, glm::vec4 const& value);
+    void SetMat3(UniformId id, glm::mat3 const& value);
+    void SetMat4(UniformId id, glm::mat4 const& value);
+
+    // 不存在（或被优化掉）的 uniform 返回 -1
+    GLint GetUniformLocation(UniformId id) const;
+
+    // GLSL 330 不能写 layout(binding = N)，在这里把 uniform block 关联到绑定点（见 UniformRing::Bind）。
+    // 会等待编译完成；block 不存在时返回 false
+    bool BindUniformBlock(const char* block_name, GLuint binding);
+
+    uint64_t IssuedUniformCalls() const
+    {
+        return issued_uniform_calls_;
+    }
+
+    uint64_t SkippedUniformCalls() const
+    {
+        return skipped_uniform_calls_;
+    }
 
 private:
-    void CheckCompileErrors(GLuint shader);
-    void CheckLinkErrors(GLuint program);
+    struct UniformSlot
+    {
+        std::string name;
+        uint32_t hash = 0;
+        GLint location = -1;
+        GLenum type = 0;
+        // 影子值在 shadow_ 中的位置（以 32 位为单位）
+        uint32_t shadow_offset = 0;
+        uint32_t shadow_size = 0;
+        bool has_value = false;
+    };
+
+    // 只提交编译链接命令，不查询状态，避免在这里等待驱动
+    void SubmitBuild(const char* vertex_shader_source, const char* fragment_shader_source);
+    void FinishBuild();
+    bool CheckCompileErrors(GLuint shader);
+    bool CheckLinkErrors(GLuint program);
+    void ReflectUniforms();
+    void InsertUniform(std::string name, GLint location, GLenum type);
+    UniformSlot const* FindUniform(UniformId id) const;
+    // 值与影子不同时更新影子并返回 location，相同或不存在时返回 -1
+    GLint UpdateShadow(UniformId id, void const* value, uint32_t size);
 
 private:
     GLuint program_ = 0;
+    // 异步编译期间保留，完成后删除
+    GLuint vertex_shader_ = 0;
+    GLuint fragment_shader_ = 0;
+    uint64_t cache_key_ = 0;
+    bool ready_ = false;
+    bool linked_ = false;
+    // 开放寻址的哈希表，容量为 2 的幂，name 为空表示空槽
+    std::vector<UniformSlot> uniforms_;
+    std::vector<uint32_t> shadow_;
+    uint64_t issued_uniform_calls_ = 0;
+    uint64_t skipped_uniform_calls_ = 0;
 };
 
-} // namespace utils
\ No newline at end of file
+} // namespace utils
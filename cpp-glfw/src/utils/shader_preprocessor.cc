@@ -0,0 +1,232 @@
+#include "shader_preprocessor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace utils {
+
+namespace {
+
+bool IsIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+std::string_view TrimLeft(std::string_view text)
+{
+    size_t begin = text.find_first_not_of(" \t");
+    return begin == std::string_view::npos ? std::string_view{} : text.substr(begin);
+}
+
+// 匹配 `#include "name"`，# 前后允许空白
+bool ParseInclude(std::string_view line, std::string& name)
+{
+    line = TrimLeft(line);
+    if (line.empty() || line.front() != '#')
+    {
+        return false;
+    }
+
+    line = TrimLeft(line.substr(1));
+    constexpr std::string_view INCLUDE = "include";
+    if (!line.starts_with(INCLUDE))
+    {
+        return false;
+    }
+
+    line = TrimLeft(line.substr(INCLUDE.size()));
+    size_t close = line.find('"', 1);
+    if (line.empty() || line.front() != '"' || close == std::string_view::npos)
+    {
+        return false;
+    }
+
+    name = std::string(line.substr(1, close - 1));
+    return true;
+}
+
+class IncludeExpander
+{
+public:
+    IncludeExpander(std::vector<std::string> const& include_dirs, ShaderSource& source, std::string* error)
+        : include_dirs_(include_dirs)
+        , source_(source)
+        , error_(error)
+    {
+    }
+
+    bool Expand(std::filesystem::path const& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            return Fail("cannot open " + path.string());
+        }
+
+        std::string canonical = std::filesystem::weakly_canonical(path).string();
+        if (std::find(expanded_.begin(), expanded_.end(), canonical) != expanded_.end())
+        {
+            return true;
+        }
+        expanded_.push_back(canonical);
+
+        size_t file_index = source_.files.size();
+        source_.files.push_back(path.string());
+        if (file_index > 0)
+        {
+            source_.text += "#line 1 " + std::to_string(file_index) + "\n";
+        }
+
+        std::string line;
+        std::string include_name;
+        int line_number = 0;
+        while (std::getline(in, line))
+        {
+            ++line_number;
+            if (!ParseInclude(line, include_name))
+            {
+                source_.text += line;
+                source_.text += '\n';
+                continue;
+            }
+
+            std::filesystem::path include_path = Resolve(path.parent_path(), include_name);
+            if (include_path.empty())
+            {
+                return Fail(path.string() + ":" + std::to_string(line_number) + ": cannot find include \"" +
+                            include_name + "\"");
+            }
+            if (!Expand(include_path))
+            {
+                return false;
+            }
+            // 回到当前文件，下一行的行号是 line_number + 1
+            source_.text += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+        }
+        return true;
+    }
+
+private:
+    std::filesystem::path Resolve(std::filesystem::path const& directory, std::string const& name) const
+    {
+        std::error_code error;
+        std::filesystem::path candidate = directory / name;
+        if (std::filesystem::exists(candidate, error))
+        {
+            return candidate;
+        }
+
+        for (std::string const& include_dir : include_dirs_)
+        {
+            candidate = std::filesystem::path(include_dir) / name;
+            if (std::filesystem::exists(candidate, error))
+            {
+                return candidate;
+            }
+        }
+        return {};
+    }
+
+    bool Fail(std::string message)
+    {
+        if (error_)
+        {
+            *error_ = std::move(message);
+        }
+        return false;
+    }
+
+private:
+    std::vector<std::string> const& include_dirs_;
+    ShaderSource& source_;
+    std::string* error_;
+    std::vector<std::string> expanded_;
+};
+
+} // namespace
+
+bool LoadShaderSource(std::string const& path, std::vector<std::string> const& include_dirs, ShaderSource& source,
+                      std::string* error)
+{
+    source = ShaderSource{};
+    IncludeExpander expander(include_dirs, source, error);
+    return expander.Expand(path);
+}
+
+std::string InjectDefines(std::string_view source, std::string_view stage_define,
+                          std::vector<std::string> const& features, uint32_t mask)
+{
+    std::string defines;
+    if (!stage_define.empty())
+    {
+        defines += "#define ";
+        defines += stage_define;
+        defines += '\n';
+    }
+    for (size_t i = 0; i < features.size(); ++i)
+    {
+        if (mask & (1u << i))
+        {
+            defines += "#define " + features[i] + "\n";
+        }
+    }
+
+    // #version 必须是第一条指令，宏定义放在它后面；没有 #version 时放在最前面
+    size_t insert_at = 0;
+    int version_line = 0;
+    size_t line_begin = 0;
+    for (int line = 1; line_begin < source.size(); ++line)
+    {
+        size_t line_end = source.find('\n', line_begin);
+        std::string_view text = source.substr(line_begin, line_end - line_begin);
+        if (TrimLeft(text).starts_with("#version"))
+        {
+            insert_at = (line_end == std::string_view::npos) ? source.size() : line_end + 1;
+            version_line = line;
+            break;
+        }
+        if (line_end == std::string_view::npos)
+        {
+            break;
+        }
+        line_begin = line_end + 1;
+    }
+
+    std::string result;
+    result.reserve(source.size() + defines.size() + 16);
+    result.append(source.substr(0, insert_at));
+    if (insert_at > 0 && result.back() != '\n')
+    {
+        result += '\n';
+    }
+    result += defines;
+    // 保持编译错误里的行号与原文件一致
+    result += "#line " + std::to_string(version_line + 1) + " 0\n";
+    result.append(source.substr(insert_at));
+    return result;
+}
+
+uint32_t ReferencedFeatures(std::string_view source, std::vector<std::string> const& features)
+{
+    uint32_t referenced = 0;
+    for (size_t i = 0; i < features.size(); ++i)
+    {
+        std::string_view name = features[i];
+        for (size_t pos = source.find(name); pos != std::string_view::npos; pos = source.find(name, pos + 1))
+        {
+            bool starts = (pos == 0) || !IsIdentifierChar(source[pos - 1]);
+            bool ends = (pos + name.size() == source.size()) || !IsIdentifierChar(source[pos + name.size()]);
+            if (starts && ends)
+            {
+                referenced |= 1u << i;
+                break;
+            }
+        }
+    }
+    return referenced;
+}
+
+} // namespace utils
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+// 展开 #include 之后的 GLSL 源码
+struct ShaderSource
+{
+    std::string text;
+    // 参与展开的文件，下标就是 #line 指令里的源字符串编号，编译错误里的 "0(12)" 指 files[0] 第 12 行
+    std::vector<std::string> files;
+};
+
+// 读取 path 并递归展开 #include "file"。被包含的文件先在包含者所在目录查找，再依次在 include_dirs 中查找；
+// 每个文件只展开一次（相当于都带有 #pragma once），循环包含因此也不会死循环。
+// 不处理 #if，条件编译交给驱动，所以被 #ifdef 包住的 #include 也会展开。
+bool LoadShaderSource(std::string const& path, std::vector<std::string> const& include_dirs, ShaderSource& source,
+                      std::string* error = nullptr);
+
+// 在 #version 之后插入宏定义：stage_define（例如 VERTEX_SHADER），以及 features 中 mask 对应位为 1 的宏
+std::string InjectDefines(std::string_view source, std::string_view stage_define,
+                          std::vector<std::string> const& features, uint32_t mask);
+
+// source 中以完整标识符出现过的 feature 对应的位
+uint32_t ReferencedFeatures(std::string_view source, std::vector<std::string> const& features);
+
+} // namespace utils
@@ -0,0 +1,55 @@
+#include "shader_variants.h"
+#include "profiler.h"
+
+#include <cassert>
+#include <iostream>
+
+#define ASSERT assert
+
+namespace utils {
+
+ShaderVariants::ShaderVariants(std::string const& vertex_path, std::string const& fragment_path,
+                               std::vector<std::string> features, std::vector<std::string> include_dirs)
+    : features_(std::move(features))
+{
+    PROFILE_ZONE("ShaderVariants::ShaderVariants");
+    ASSERT(features_.size() <= 32);
+
+    std::string error;
+    loaded_ = LoadShaderSource(vertex_path, include_dirs, vertex_source_, &error) &&
+              LoadShaderSource(fragment_path, include_dirs, fragment_source_, &error);
+    if (!loaded_)
+    {
+        std::cout << "ERROR::SHADER::PREPROCESS_FAILED\n" << error << "\n";
+        return;
+    }
+
+    referenced_mask_ =
+        ReferencedFeatures(vertex_source_.text, features_) | ReferencedFeatures(fragment_source_.text, features_);
+}
+
+Shader& ShaderVariants::Get(uint32_t mask)
+{
+    uint32_t effective_mask = mask & referenced_mask_;
+    auto it = programs_.find(effective_mask);
+    if (it != programs_.end())
+    {
+        return *it->second;
+    }
+
+    PROFILE_ZONE("ShaderVariants::Get");
+    std::string vertex_text = InjectDefines(vertex_source_.text, "VERTEX_SHADER", features_, effective_mask);
+    std::string fragment_text = InjectDefines(fragment_source_.text, "FRAGMENT_SHADER", features_, effective_mask);
+    auto shader = std::make_unique<Shader>(vertex_text.c_str(), fragment_text.c_str(), ShaderBuild::Async);
+    return *programs_.emplace(effective_mask, std::move(shader)).first->second;
+}
+
+void ShaderVariants::Prewarm(std::initializer_list<uint32_t> masks)
+{
+    for (uint32_t mask : masks)
+    {
+        Get(mask);
+    }
+}
+
+} // namespace utils
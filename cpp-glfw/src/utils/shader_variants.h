@@ -0,0 +1,55 @@
+#pragma once
+
+#include "shader.h"
+#include "shader_preprocessor.h"
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace utils {
+
+// 同一对 shader 文件按特性宏编译出的多个版本（permutation）
+//
+// features[i] 对应 mask 的第 i 位，为 1 时在 #version 之后 #define 这个宏，各个版本在编译期去掉用不到的分支，
+// 不需要在片元着色器里按 uniform 动态分支。只有源码中真正出现过的宏才参与区分版本，
+// 因此只差一个无关宏的两个 mask 共用同一个 program。
+class ShaderVariants
+{
+public:
+    ShaderVariants(std::string const& vertex_path, std::string const& fragment_path, std::vector<std::string> features,
+                   std::vector<std::string> include_dirs = {});
+
+    ShaderVariants(ShaderVariants const&) = delete;
+    ShaderVariants& operator=(ShaderVariants const&) = delete;
+
+    bool IsLoaded() const
+    {
+        return loaded_;
+    }
+
+    // 第一次请求某个版本时才编译（异步提交，第一次 Use() 时等待完成）
+    Shader& Get(uint32_t mask);
+
+    // 提前提交一批版本的异步编译，和其他加载工作重叠
+    void Prewarm(std::initializer_list<uint32_t> masks);
+
+    // 实际编译过的 program 数
+    size_t ProgramCount() const
+    {
+        return programs_.size();
+    }
+
+private:
+    std::vector<std::string> features_;
+    ShaderSource vertex_source_;
+    ShaderSource fragment_source_;
+    uint32_t referenced_mask_ = 0;
+    bool loaded_ = false;
+    // 按有效 mask（去掉没出现过的宏）去重
+    std::unordered_map<uint32_t, std::unique_ptr<Shader>> programs_;
+};
+
+} // namespace utils
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace utils {
+
+// std140 布局规则（OpenGL 4.6 规范 7.6.2.2）在编译期的实现
+//
+// 用法：按 GLSL 里 uniform block 的成员顺序列出 C++ 类型，检查结构体各成员的偏移：
+//   struct Transform { glm::mat4 matrix; glm::vec4 color; };
+//   static_assert(utils::std140::CheckLayout<glm::mat4, glm::vec4>(
+//       {offsetof(Transform, matrix), offsetof(Transform, color)}, sizeof(Transform)));
+//
+// 常见的坑：vec3 按 16 字节对齐（后面可以紧跟一个 float）、数组元素和矩阵的列都按 16 字节对齐，
+// 所以 mat3 要写成 glm::mat3x4，float 数组要写成 glm::vec4 数组。
+namespace std140 {
+
+template <typename T>
+struct Traits;
+
+template <size_t Alignment, size_t Size>
+struct TraitsBase
+{
+    static constexpr size_t ALIGNMENT = Alignment;
+    static constexpr size_t SIZE = Size;
+};
+
+// clang-format off
+template <> struct Traits<float> : TraitsBase<4, 4> {};
+template <> struct Traits<int32_t> : TraitsBase<4, 4> {};
+template <> struct Traits<uint32_t> : TraitsBase<4, 4> {};
+template <> struct Traits<glm::vec2> : TraitsBase<8, 8> {};
+template <> struct Traits<glm::vec3> : TraitsBase<16, 12> {};
+template <> struct Traits<glm::vec4> : TraitsBase<16, 16> {};
+template <> struct Traits<glm::ivec4> : TraitsBase<16, 16> {};
+template <> struct Traits<glm::mat3x4> : TraitsBase<16, 48> {};
+template <> struct Traits<glm::mat4> : TraitsBase<16, 64> {};
+// clang-format on
+
+// 数组的步长向上取整到 16 字节，只支持 C++ 侧步长也是 16 的倍数的元素，其余的在 C++ 里无法直接对上
+template <typename T, size_t N>
+struct Traits<T[N]> : TraitsBase<16, Traits<T>::SIZE * N>
+{
+    static_assert(Traits<T>::SIZE % 16 == 0 && sizeof(T) == Traits<T>::SIZE,
+                  "std140 array elements are padded to 16 bytes, use vec4 / mat4 elements");
+};
+
+constexpr size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// 成员的 std140 偏移
+template <typename... Ts>
+constexpr std::array<size_t, sizeof...(Ts)> Offsets()
+{
+    std::array<size_t, sizeof...(Ts)> offsets{};
+    size_t offset = 0;
+    size_t index = 0;
+    ((offset = AlignUp(offset, Traits<Ts>::ALIGNMENT), offsets[index++] = offset, offset += Traits<Ts>::SIZE), ...);
+    return offsets;
+}
+
+// 整个 block 的大小，末尾补齐到 16 字节（block 作为结构体时的对齐）
+template <typename... Ts>
+constexpr size_t BlockSize()
+{
+    size_t size = 0;
+    ((size = AlignUp(size, Traits<Ts>::ALIGNMENT) + Traits<Ts>::SIZE), ...);
+    return AlignUp(size, 16);
+}
+
+// 每个成员的 C++ 偏移都与 std140 一致，并且结构体大小不小于 block 大小（否则上传时会越界读）
+template <typename... Ts>
+consteval bool CheckLayout(std::array<size_t, sizeof...(Ts)> offsets, size_t struct_size)
+{
+    return offsets == Offsets<Ts...>() && struct_size >= BlockSize<Ts...>();
+}
+
+} // namespace std140
+
+} // namespace utils
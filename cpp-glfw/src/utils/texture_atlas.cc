@@ -0,0 +1,443 @@
+#include "texture_atlas.h"
+#include "cooked_texture.h"
+#include "gl_state.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+#include "profiler.h"
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+
+namespace utils {
+
+namespace {
+
+int RoundUpToPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+int AlignUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::vector<uint8_t> ConvertToRgba(const uint8_t* pixels, size_t pixel_count, int channels)
+{
+    std::vector<uint8_t> rgba(pixel_count * 4);
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        const uint8_t* in = pixels + i * channels;
+        uint8_t* out = &rgba[i * 4];
+        switch (channels)
+        {
+        case 1:
+            out[0] = out[1] = out[2] = in[0];
+            out[3] = 255;
+            break;
+        case 2:
+            out[0] = out[1] = out[2] = in[0];
+            out[3] = in[1];
+            break;
+        case 3:
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+            out[3] = 255;
+            break;
+        default:
+            memcpy(out, in, 4);
+            break;
+        }
+    }
+    return rgba;
+}
+
+bool EndsWith(std::string const& text, std::string const& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : width_(width)
+    , height_(height)
+{
+    segments_.push_back({0, 0, width});
+}
+
+bool SkylinePacker::Pack(int width, int height, int& x, int& y)
+{
+    if (width <= 0 || height <= 0 || width > width_ || height > height_)
+    {
+        return false;
+    }
+
+    // 上边最低的位置优先，相同时选更窄的一段，减少留下的缝隙
+    size_t best_index = segments_.size();
+    int best_top = std::numeric_limits<int>::max();
+    int best_width = std::numeric_limits<int>::max();
+    for (size_t i = 0; i < segments_.size(); ++i)
+    {
+        int fit_y = FitY(i, width);
+        if (fit_y < 0 || fit_y + height > height_)
+        {
+            continue;
+        }
+        int top = fit_y + height;
+        if (top < best_top || (top == best_top && segments_[i].width < best_width))
+        {
+            best_index = i;
+            best_top = top;
+            best_width = segments_[i].width;
+            y = fit_y;
+        }
+    }
+    if (best_index == segments_.size())
+    {
+        return false;
+    }
+
+    x = segments_[best_index].x;
+    Insert(best_index, x, y, width, height);
+    used_area_ += static_cast<int64_t>(width) * height;
+    return true;
+}
+
+double SkylinePacker::Occupancy() const
+{
+    return static_cast<double>(used_area_) / (static_cast<double>(width_) * height_);
+}
+
+int SkylinePacker::FitY(size_t index, int width) const
+{
+    if (segments_[index].x + width > width_)
+    {
+        return -1;
+    }
+
+    int y = 0;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; ++i)
+    {
+        y = std::max(y, segments_[i].y);
+        remaining -= segments_[i].width;
+    }
+    return y;
+}
+
+void SkylinePacker::Insert(size_t index, int x, int y, int width, int height)
+{
+    segments_.insert(segments_.begin() + static_cast<std::ptrdiff_t>(index), {x, y + height, width});
+
+    // 新段遮住的部分从后面的段里去掉
+    size_t i = index + 1;
+    while (i < segments_.size())
+    {
+        Segment& segment = segments_[i];
+        int overlap = x + width - segment.x;
+        if (overlap <= 0)
+        {
+            break;
+        }
+        if (overlap >= segment.width)
+        {
+            segments_.erase(segments_.begin() + static_cast<std::ptrdiff_t>(i));
+            continue;
+        }
+        segment.x += overlap;
+        segment.width -= overlap;
+        break;
+    }
+
+    // 合并高度相同的相邻段
+    for (size_t j = 0; j + 1 < segments_.size();)
+    {
+        if (segments_[j].y == segments_[j + 1].y)
+        {
+            segments_[j].width += segments_[j + 1].width;
+            segments_.erase(segments_.begin() + static_cast<std::ptrdiff_t>(j + 1));
+        }
+        else
+        {
+            ++j;
+        }
+    }
+}
+
+TextureAtlas::TextureAtlas(AtlasOptions const& options)
+    : options_(options)
+{
+    options_.padding = std::max(0, options_.padding);
+    options_.gutter = std::max(0, options_.gutter);
+    page_size_ = RoundUpToPowerOfTwo(std::max(1, options_.page_size));
+
+    // 第 k 级 gutter 剩下 gutter / 2^k 个像素，至少要保留 1 个
+    if (options_.mipmaps)
+    {
+        while ((options_.gutter >> mip_levels_) > 0 && (page_size_ >> mip_levels_) > 0)
+        {
+            ++mip_levels_;
+        }
+    }
+    alignment_ = 1 << (mip_levels_ - 1);
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    if (pool_)
+    {
+        pool_->WaitIdle();
+    }
+}
+
+int TextureAtlas::Add(const uint8_t* pixels, int width, int height, int channels)
+{
+    if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+    {
+        return -1;
+    }
+
+    // 槽位按 2^(mip_levels - 1) 对齐，缩小到最后一级时每个像素仍然只覆盖同一个槽位
+    int slot_width = AlignUp(width + options_.gutter * 2 + options_.padding, alignment_);
+    int slot_height = AlignUp(height + options_.gutter * 2 + options_.padding, alignment_);
+    if (slot_width > page_size_ || slot_height > page_size_)
+    {
+        std::cout << "ERROR: Image " << width << "x" << height << " does not fit in a " << page_size_
+                  << " atlas page\n";
+        return -1;
+    }
+
+    int x = 0;
+    int y = 0;
+    size_t page_index = 0;
+    for (; page_index < pages_.size(); ++page_index)
+    {
+        if (pages_[page_index].packer.Pack(slot_width, slot_height, x, y))
+        {
+            break;
+        }
+    }
+    if (page_index == pages_.size())
+    {
+        pages_.push_back({SkylinePacker(page_size_, page_size_), {}, nullptr, true});
+        pages_.back().pixels.assign(static_cast<size_t>(page_size_) * page_size_ * 4, 0);
+        pages_.back().packer.Pack(slot_width, slot_height, x, y);
+    }
+
+    Page& page = pages_[page_index];
+    std::vector<uint8_t> rgba;
+    if (channels != 4)
+    {
+        rgba = ConvertToRgba(pixels, static_cast<size_t>(width) * height, channels);
+        pixels = rgba.data();
+    }
+    Blit(page, pixels, width, height, x + options_.gutter, y + options_.gutter);
+    page.dirty = true;
+
+    AtlasRegion region;
+    region.page = static_cast<int>(page_index);
+    region.x = x + options_.gutter;
+    region.y = y + options_.gutter;
+    region.width = width;
+    region.height = height;
+    float scale = 1.0f / static_cast<float>(page_size_);
+    region.u0 = static_cast<float>(region.x) * scale;
+    region.v0 = static_cast<float>(region.y) * scale;
+    region.u1 = static_cast<float>(region.x + width) * scale;
+    region.v1 = static_cast<float>(region.y + height) * scale;
+    regions_.push_back(region);
+    return static_cast<int>(regions_.size() - 1);
+}
+
+int TextureAtlas::AddFile(std::string const& path, bool flip_vertically)
+{
+    if (EndsWith(path, cooked_texture::EXTENSION))
+    {
+        MappedFile file;
+        cooked_texture::View view;
+        std::string error;
+        if (!file.Open(path) || !cooked_texture::Parse(file.Data(), file.Size(), view, &error))
+        {
+            std::cout << "ERROR: Load cooked texture failed: " << path << " (" << error << ")\n";
+            return -1;
+        }
+        // 图集的页是 RGBA8，压缩过的块数据不能直接拼进去
+        if (view.header->format != 0)
+        {
+            std::cout << "ERROR: " << path << " is block compressed, cannot add it to an atlas\n";
+            return -1;
+        }
+        return Add(view.LevelPixels(0), static_cast<int>(view.levels[0].width),
+                   static_cast<int>(view.levels[0].height), static_cast<int>(view.header->channels));
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_set_flip_vertically_on_load_thread(flip_vertically);
+    uint8_t* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (!pixels)
+    {
+        std::cout << "ERROR: Load image failed: " << path << " (" << stbi_failure_reason() << ")\n";
+        return -1;
+    }
+    int index = Add(pixels, width, height, channels);
+    stbi_image_free(pixels);
+    return index;
+}
+
+int TextureAtlas::AddCookedOrFile(std::string const& cooked_path, std::string const& source_path,
+                                  bool flip_vertically)
+{
+    std::error_code ec;
+    if (std::filesystem::exists(cooked_path, ec))
+    {
+        if (int index = AddFile(cooked_path, flip_vertically); index >= 0)
+        {
+            return index;
+        }
+    }
+    return AddFile(source_path, flip_vertically);
+}
+
+void TextureAtlas::Build()
+{
+    for (size_t index = 0; index < pages_.size(); ++index)
+    {
+        Page& page = pages_[index];
+        if (!page.dirty)
+        {
+            continue;
+        }
+        Upload(page);
+        page.dirty = false;
+        ++page.generation;
+        if (mip_levels_ > 1)
+        {
+            if (!pool_)
+            {
+                pool_ = std::make_unique<ThreadPool>();
+            }
+            // 工作线程用一份快照，生成期间还可以继续往页里添加图片
+            auto pixels = std::make_shared<std::vector<uint8_t> const>(page.pixels);
+            uint64_t generation = page.generation;
+            page.mips_pending = true;
+            pool_->Submit([this, index, generation, pixels] { GenerateMips(index, generation, pixels); });
+        }
+    }
+}
+
+bool TextureAtlas::Update()
+{
+    std::vector<GeneratedMips> generated;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generated.swap(generated_);
+    }
+    for (GeneratedMips const& mips : generated)
+    {
+        Page& page = pages_[mips.page];
+        // 生成期间页又被修改、重新上传过，等后提交的那一批
+        if (mips.generation != page.generation)
+        {
+            continue;
+        }
+        PROFILE_ZONE("TextureAtlas::UploadMips");
+        GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, page.texture->Id());
+        for (size_t i = 0; i < mips.levels.size(); ++i)
+        {
+            MipLevel const& mip = mips.levels[i];
+            glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), 0, 0, mip.width, mip.height, GL_RGBA,
+                            GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.levels.size()));
+        page.mips_pending = false;
+    }
+    return std::any_of(pages_.begin(), pages_.end(), [](Page const& page) { return page.mips_pending; });
+}
+
+void TextureAtlas::SetProgressCallback(std::function<void()> on_progress)
+{
+    on_progress_ = std::move(on_progress);
+}
+
+void TextureAtlas::Blit(Page& page, const uint8_t* rgba, int width, int height, int x, int y) const
+{
+    int gutter = options_.gutter;
+    size_t row_bytes = static_cast<size_t>(width) * 4;
+    for (int row = -gutter; row < height + gutter; ++row)
+    {
+        const uint8_t* source = rgba + static_cast<size_t>(std::clamp(row, 0, height - 1)) * row_bytes;
+        uint8_t* target = &page.pixels[(static_cast<size_t>(y + row) * page_size_ + x) * 4];
+        memcpy(target, source, row_bytes);
+        // 左右的 gutter 重复第一列和最后一列
+        for (int column = 1; column <= gutter; ++column)
+        {
+            memcpy(target - column * 4, source, 4);
+            memcpy(target + row_bytes + (column - 1) * 4, source + row_bytes - 4, 4);
+        }
+    }
+}
+
+void TextureAtlas::Upload(Page& page) const
+{
+    PROFILE_ZONE("TextureAtlas::Upload");
+    auto& gl_state = GLStateCache::Current();
+    if (!page.texture)
+    {
+        GLuint id = 0;
+        glGenTextures(1, &id);
+        gl_state.BindTextureForUpdate(0, GL_TEXTURE_2D, id);
+        AllocateTexture2D(mip_levels_, GL_RGBA8, page_size_, page_size_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mip_levels_ > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options_.mag_filter);
+
+        size_t gpu_bytes = 0;
+        for (int level = 0; level < mip_levels_; ++level)
+        {
+            size_t size = static_cast<size_t>(page_size_ >> level);
+            gpu_bytes += size * size * 4;
+        }
+        page.texture = std::make_shared<Texture>(id, page_size_, page_size_, 4, gpu_bytes);
+    }
+    else
+    {
+        gl_state.BindTextureForUpdate(0, GL_TEXTURE_2D, page.texture->Id());
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, page_size_, page_size_, GL_RGBA, GL_UNSIGNED_BYTE, page.pixels.data());
+    // 其余各级还是旧的（或未定义），新的 mipmap 上传之前只采样第 0 级
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+}
+
+void TextureAtlas::GenerateMips(size_t page, uint64_t generation, std::shared_ptr<std::vector<uint8_t> const> pixels)
+{
+    PROFILE_ZONE("TextureAtlas::GenerateMips");
+    // 2 的幂的页按 Box 缩小正好是 2x2 平均，对齐的槽位之间互不影响；gutter 用完之后的级别不会被采样，不生成
+    MipOptions mip_options{MipFilter::Box, options_.srgb, options_.premultiplied_alpha};
+    GeneratedMips mips{page, generation,
+                       GenerateMipChain(pixels->data(), page_size_, page_size_, 4, mip_options, mip_levels_ - 1)};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generated_.push_back(std::move(mips));
+    }
+    if (on_progress_)
+    {
+        on_progress_();
+    }
+}
+
+} // namespace utils
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "textures.h"
+#include "thread_pool.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+// Skyline bottom-left 装箱：记录每一段已占用区域的上沿，新矩形放在能让它的上边最低的位置。
+// 只能添加不能删除，适合一次性或逐步增长的图集
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    // 放不下时返回 false
+    bool Pack(int width, int height, int& x, int& y);
+
+    // 已占用的面积占比
+    double Occupancy() const;
+
+private:
+    struct Segment
+    {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+    };
+
+    // 从 segments_[index] 开始放宽 width 的矩形时底边的高度，超出宽度时返回 -1
+    int FitY(size_t index, int width) const;
+    void Insert(size_t index, int x, int y, int width, int height);
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    int64_t used_area_ = 0;
+    std::vector<Segment> segments_;
+};
+
+struct AtlasOptions
+{
+    // 每页的边长，向上取整为 2 的幂
+    int page_size = 2048;
+    // 图片之间额外留出的透明像素
+    int padding = 0;
+    // 每张图片四周向外复制边缘像素的宽度，双线性采样和缩小后的 mipmap 不会混入相邻的图片。
+    // mipmap 只生成到 gutter 仍至少有 1 个像素的那一级，每个槽位按 2^该级 对齐
+    int gutter = 8;
+    bool mipmaps = true;
+    // 见 MipOptions；图集固定使用 Box 滤波，更宽的核会跨过对齐的槽位
+    bool srgb = false;
+    bool premultiplied_alpha = false;
+    GLint mag_filter = GL_LINEAR;
+};
+
+struct AtlasRegion
+{
+    int page = -1;
+    // 图片在页内的像素位置，不包括 gutter
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    // 对应的纹理坐标范围，(u0, v0) 是图片第一行第一列的角
+    float u0 = 0.0f;
+    float v0 = 0.0f;
+    float u1 = 0.0f;
+    float v1 = 0.0f;
+};
+
+// 把许多小图片装进少数几张 RGBA8 纹理里，精灵、图标可以共用一次绑定、合并成一次绘制。
+// 像素先在 CPU 上拼好，Build() 时逐页上传（只上传有变化的页）。
+// mipmap 在工作线程上生成，由之后的 Update() 上传；在那之前页纹理只有第 0 级
+class TextureAtlas
+{
+public:
+    explicit TextureAtlas(AtlasOptions const& options = {});
+
+    // 等待工作线程上的 mipmap 生成结束
+    ~TextureAtlas();
+
+    TextureAtlas(TextureAtlas const&) = delete;
+    TextureAtlas& operator=(TextureAtlas const&) = delete;
+
+    // 返回图片编号；比一页还大或参数无效时返回 -1。任意通道数都转换成 RGBA
+    int Add(const uint8_t* pixels, int width, int height, int channels);
+
+    // 解码图片文件后添加；.gltex 直接使用烘焙好的第 0 级（朝向在烘焙时已经确定，忽略 flip_vertically）
+    int AddFile(std::string const& path, bool flip_vertically = false);
+
+    // 优先添加烘焙好的版本，不存在或无效时解码源图片
+    int AddCookedOrFile(std::string const& cooked_path, std::string const& source_path, bool flip_vertically = false);
+
+    // 在渲染线程上调用，创建或更新有变化的页（第 0 级），并为这些页发起 mipmap 生成
+    void Build();
+
+    // 在渲染线程、绘制之前调用，上传生成好的 mipmap。返回 true 表示还有页在生成，需要继续调度下一帧
+    bool Update();
+
+    // mipmap 生成好时在工作线程上调用，OnDemand 模式下用来唤醒消息循环
+    void SetProgressCallback(std::function<void()> on_progress);
+
+    AtlasRegion const& Region(int index) const
+    {
+        return regions_[static_cast<size_t>(index)];
+    }
+
+    size_t RegionCount() const
+    {
+        return regions_.size();
+    }
+
+    size_t PageCount() const
+    {
+        return pages_.size();
+    }
+
+    // Build() 之前为空
+    TextureHandle PageTexture(int page) const
+    {
+        return pages_[static_cast<size_t>(page)].texture;
+    }
+
+    int PageSize() const
+    {
+        return page_size_;
+    }
+
+    int MipLevels() const
+    {
+        return mip_levels_;
+    }
+
+private:
+    struct Page
+    {
+        SkylinePacker packer;
+        std::vector<uint8_t> pixels;
+        std::shared_ptr<Texture> texture;
+        bool dirty = true;
+        // 每次 Build() 上传时加 1，丢弃页在生成期间又被修改过的旧 mipmap
+        uint64_t generation = 0;
+        bool mips_pending = false;
+    };
+
+    struct GeneratedMips
+    {
+        size_t page = 0;
+        uint64_t generation = 0;
+        std::vector<MipLevel> levels;
+    };
+
+    // 把一张 RGBA 图片拷到页内 (x, y) 处，并向四周复制 gutter
+    void Blit(Page& page, const uint8_t* rgba, int width, int height, int x, int y) const;
+    void Upload(Page& page) const;
+    // 在工作线程上为页的快照生成第 1 级到 mip_levels_ - 1 级
+    void GenerateMips(size_t page, uint64_t generation, std::shared_ptr<std::vector<uint8_t> const> pixels);
+
+private:
+    AtlasOptions options_;
+    int page_size_ = 0;
+    int mip_levels_ = 1;
+    int alignment_ = 1;
+    std::vector<Page> pages_;
+    std::vector<AtlasRegion> regions_;
+    std::function<void()> on_progress_;
+
+    // 工作线程产出，渲染线程消费
+    std::mutex mutex_;
+    std::vector<GeneratedMips> generated_;
+    // 第一次需要生成 mipmap 时创建；放在最后，析构时先于其他成员等待工作线程结束
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace utils
@@ -0,0 +1,327 @@
+#include "texture_streamer.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "profiler.h"
+#include "stb_image/stb_image.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace utils {
+
+TextureStreamer::TextureStreamer(size_t thread_count)
+    : pool_(thread_count)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    pool_.WaitIdle();
+
+    auto& gl_state = GLStateCache::Current();
+    for (auto& job : ready_)
+    {
+        if (job->mapped)
+        {
+            gl_state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, job->pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (job->pbo)
+        {
+            gl_state.DeleteBuffers(1, &job->pbo);
+        }
+    }
+    gl_state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!free_buffers_.empty())
+    {
+        gl_state.DeleteBuffers(static_cast<GLsizei>(free_buffers_.size()), free_buffers_.data());
+    }
+}
+
+void TextureStreamer::Request(std::string path, bool flip_vertically, Callback on_ready,
+                              std::optional<MipOptions> mips, bool compress)
+{
+    auto job = std::make_shared<Job>();
+    job->path = std::move(path);
+    job->flip_vertically = flip_vertically;
+    job->mip_options = mips;
+    job->compress = compress;
+    job->on_ready = std::move(on_ready);
+
+    ++pending_;
+    ++stats_.requested;
+    pool_.Submit([this, job] { Decode(job); });
+}
+
+void TextureStreamer::SetProgressCallback(std::function<void()> on_progress)
+{
+    on_progress_ = std::move(on_progress);
+}
+
+bool TextureStreamer::Update(size_t upload_budget)
+{
+    if (pending_ == 0)
+    {
+        return false;
+    }
+    PROFILE_ZONE("TextureStreamer::Update");
+
+    std::vector<std::shared_ptr<Job>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready.swap(ready_);
+    }
+
+    // 超出预算的留到下一帧，按完成顺序处理
+    std::vector<std::shared_ptr<Job>> deferred;
+    size_t mapped_bytes = 0;
+    size_t uploaded_bytes = 0;
+    for (auto& job : ready)
+    {
+        switch (job->stage)
+        {
+        case Stage::Decoded:
+            if (mapped_bytes > 0 && mapped_bytes + job->size > upload_budget)
+            {
+                deferred.push_back(std::move(job));
+                break;
+            }
+            mapped_bytes += job->size;
+            Map(std::move(job));
+            break;
+        case Stage::Filled:
+            if (uploaded_bytes > 0 && uploaded_bytes + job->size > upload_budget)
+            {
+                deferred.push_back(std::move(job));
+                break;
+            }
+            uploaded_bytes += job->size;
+            Upload(*job);
+            break;
+        case Stage::Failed:
+            std::cout << "ERROR: Load image failed: " << job->path << "\n";
+            ++stats_.failed;
+            --pending_;
+            job->on_ready(job->image);
+            break;
+        }
+    }
+
+    if (!deferred.empty())
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.insert(ready_.begin(), std::make_move_iterator(deferred.begin()),
+                      std::make_move_iterator(deferred.end()));
+    }
+    return pending_ > 0;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const
+{
+    Stats stats = stats_;
+    stats.decode_ms = static_cast<double>(decode_us_.load()) / 1000.0;
+    stats.mip_ms = static_cast<double>(mip_us_.load()) / 1000.0;
+    stats.compress_ms = static_cast<double>(compress_us_.load()) / 1000.0;
+    return stats;
+}
+
+void TextureStreamer::Decode(std::shared_ptr<Job> job)
+{
+    PROFILE_ZONE("TextureStreamer::Decode");
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> file_data;
+    {
+        std::ifstream in(job->path, std::ios::binary);
+        if (in)
+        {
+            file_data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+    }
+
+    uint8_t* pixels = nullptr;
+    if (!file_data.empty())
+    {
+        // 全局的 stbi_set_flip_vertically_on_load 会影响所有线程，这里只设置当前线程
+        stbi_set_flip_vertically_on_load_thread(job->flip_vertically);
+        pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &job->image.width,
+                                       &job->image.height, &job->image.channels, 0);
+    }
+
+    if (pixels)
+    {
+        job->image.decoded = true;
+        job->image.content_hash = Fnv1a64(file_data.data(), file_data.size());
+        job->pixels.reset(pixels, stbi_image_free);
+        job->stage = Stage::Decoded;
+    }
+    else
+    {
+        job->stage = Stage::Failed;
+    }
+
+    auto decoded = std::chrono::steady_clock::now();
+    decode_us_ += std::chrono::duration_cast<std::chrono::microseconds>(decoded - start).count();
+    if (!pixels)
+    {
+        Post(std::move(job));
+        return;
+    }
+
+    StreamedImage& image = job->image;
+    if (job->mip_options)
+    {
+        job->mips = GenerateMipChain(pixels, image.width, image.height, image.channels, *job->mip_options);
+        auto elapsed = std::chrono::steady_clock::now() - decoded;
+        mip_us_ += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    }
+
+    image.size = static_cast<size_t>(image.width) * image.height * image.channels;
+    if (job->compress)
+    {
+        BlockFormat format = BlockFormatForChannels(image.channels);
+        // 这里已经在工作线程上，不同图片之间并行，单张图片不再拆分
+        auto compress_start = std::chrono::steady_clock::now();
+        auto blocks = std::make_shared<std::vector<uint8_t>>(
+            CompressImage(pixels, image.width, image.height, image.channels, format));
+        job->pixels = std::shared_ptr<uint8_t>(blocks, blocks->data());
+        for (MipLevel& level : job->mips)
+        {
+            level.pixels = CompressImage(level.pixels.data(), level.width, level.height, image.channels, format);
+        }
+        image.compressed_format = BlockFormatInternalFormat(format);
+        image.size = blocks->size();
+        auto elapsed = std::chrono::steady_clock::now() - compress_start;
+        compress_us_ += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    }
+
+    // 各级接在第 0 级后面，起始位置按 16 字节对齐
+    job->size = image.size;
+    for (MipLevel const& level : job->mips)
+    {
+        job->size = (job->size + 15) & ~static_cast<size_t>(15);
+        job->mip_offsets.push_back(job->size);
+        job->size += level.pixels.size();
+        image.mip_levels.push_back({level.width, level.height, level.pixels.size(), nullptr});
+    }
+    Post(std::move(job));
+}
+
+void TextureStreamer::Fill(std::shared_ptr<Job> job)
+{
+    PROFILE_ZONE("TextureStreamer::Fill");
+    auto* mapped = static_cast<uint8_t*>(job->mapped);
+    memcpy(mapped, job->pixels.get(), job->image.size);
+    for (size_t i = 0; i < job->mips.size(); ++i)
+    {
+        memcpy(mapped + job->mip_offsets[i], job->mips[i].pixels.data(), job->mips[i].pixels.size());
+    }
+    job->pixels.reset();
+    job->mips.clear();
+    job->stage = Stage::Filled;
+    Post(std::move(job));
+}
+
+void TextureStreamer::Post(std::shared_ptr<Job> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(std::move(job));
+    }
+    if (on_progress_)
+    {
+        on_progress_();
+    }
+}
+
+void TextureStreamer::Map(std::shared_ptr<Job> job)
+{
+    auto& gl_state = GLStateCache::Current();
+    job->pbo = AcquireBuffer();
+    gl_state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, job->pbo);
+    // 重新分配存储：上一次从这个 PBO 发起的上传可能还没完成，驱动会给一块新的内存而不是等待
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(job->size), nullptr, GL_STREAM_DRAW);
+    job->mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(job->size),
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    gl_state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!job->mapped)
+    {
+        ReleaseBuffer(job->pbo);
+        job->pbo = 0;
+        job->stage = Stage::Filled;
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(std::move(job));
+        return;
+    }
+    pool_.Submit([this, job] { Fill(job); });
+}
+
+void TextureStreamer::Upload(Job& job)
+{
+    PROFILE_ZONE("TextureStreamer::Upload");
+    auto& gl_state = GLStateCache::Current();
+    if (job.pbo)
+    {
+        gl_state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        job.mapped = nullptr;
+        job.image.pixels = nullptr;
+    }
+    else
+    {
+        job.image.pixels = job.pixels.get();
+    }
+    for (size_t i = 0; i < job.image.mip_levels.size(); ++i)
+    {
+        job.image.mip_levels[i].pixels =
+            job.pbo ? reinterpret_cast<const void*>(job.mip_offsets[i]) : job.mips[i].pixels.data();
+    }
+
+    job.on_ready(job.image);
+
+    if (job.pbo)
+    {
+        // 其他代码从 CPU 内存上传纹理时 GL_PIXEL_UNPACK_BUFFER 必须为 0
+        gl_state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ReleaseBuffer(job.pbo);
+        job.pbo = 0;
+    }
+    job.pixels.reset();
+    job.mips.clear();
+
+    ++stats_.completed;
+    stats_.uploaded_bytes += job.size;
+    --pending_;
+}
+
+GLuint TextureStreamer::AcquireBuffer()
+{
+    if (!free_buffers_.empty())
+    {
+        GLuint pbo = free_buffers_.back();
+        free_buffers_.pop_back();
+        return pbo;
+    }
+
+    GLuint pbo = 0;
+    glGenBuffers(1, &pbo);
+    return pbo;
+}
+
+void TextureStreamer::ReleaseBuffer(GLuint pbo)
+{
+    if (free_buffers_.size() < MAX_FREE_BUFFERS)
+    {
+        free_buffers_.push_back(pbo);
+    }
+    else
+    {
+        GLStateCache::Current().DeleteBuffers(1, &pbo);
+    }
+}
+
+} // namespace utils
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "block_compression.h"
+#include "gl_include.h"
+#include "mip_generator.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+struct StreamedLevel
+{
+    int width = 0;
+    int height = 0;
+    size_t size = 0;
+    // 与 StreamedImage::pixels 相同，PBO 内的偏移或 CPU 内存
+    const void* pixels = nullptr;
+};
+
+struct StreamedImage
+{
+    bool decoded = false;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    // 文件内容的 FNV-1a 64 哈希
+    uint64_t content_hash = 0;
+    // 不为 0 时各级都是该格式的压缩块，用 glCompressedTexImage2D 上传
+    GLenum compressed_format = 0;
+    // 第 0 级的字节数
+    size_t size = 0;
+    // 传给 glTexImage2D 的数据指针：通过 PBO 上传时是缓冲区内的偏移（nullptr），映射失败时是 CPU 内存
+    const void* pixels = nullptr;
+    // 请求了 CPU mipmap 时是第 1 级到 1x1 的各级，和第 0 级放在同一个 PBO 里
+    std::vector<StreamedLevel> mip_levels;
+};
+
+// 异步纹理加载流水线
+//
+//   工作线程：读文件、解码（按线程设置上下翻转，不影响其他线程），按需生成 mipmap 链、压缩成 S3TC 块
+//   渲染线程：分配并映射像素解包缓冲（PBO）
+//   工作线程：把像素拷进映射的 PBO
+//   渲染线程：解除映射，on_ready 里从 PBO 发起 glTexImage2D，驱动可以异步地做 DMA
+//
+// 渲染线程上只剩映射和发起上传，每帧上传的字节数受预算限制，后加载的大图不会造成卡顿。
+class TextureStreamer
+{
+public:
+    static constexpr size_t DEFAULT_UPLOAD_BUDGET = 16u << 20;
+    // 复用的 PBO 数量上限，多出来的上传完成后删除
+    static constexpr size_t MAX_FREE_BUFFERS = 4;
+
+    // 在渲染线程上调用。image.decoded 为 false 表示读文件或解码失败；
+    // 调用时已经绑定好 GL_PIXEL_UNPACK_BUFFER（映射失败时为 0），直接把 image.pixels 传给 glTexImage2D 即可
+    using Callback = std::function<void(StreamedImage const& image)>;
+
+    struct Stats
+    {
+        uint64_t requested = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t uploaded_bytes = 0;
+        // 工作线程上解码、生成 mipmap、压缩的累计耗时
+        double decode_ms = 0.0;
+        double mip_ms = 0.0;
+        double compress_ms = 0.0;
+    };
+
+    // thread_count 为 0 时见 ThreadPool
+    explicit TextureStreamer(size_t thread_count = 0);
+    // 等待工作线程结束并删除 PBO，必须在 GL 上下文销毁前调用；未完成的请求不再回调
+    ~TextureStreamer();
+
+    TextureStreamer(TextureStreamer const&) = delete;
+    TextureStreamer& operator=(TextureStreamer const&) = delete;
+
+    // mips 不为空时在工作线程上解码之后接着生成 mipmap 链，渲染线程只需要逐级上传；
+    // compress 为 true 时再把各级压缩，格式按解码出的通道数选择（调用方负责确认驱动支持 S3TC）
+    void Request(std::string path, bool flip_vertically, Callback on_ready,
+                 std::optional<MipOptions> mips = std::nullopt, bool compress = false);
+
+    // on_progress 在工作线程上调用，表示有请求需要渲染线程处理，OnDemand 模式下用来唤醒消息循环
+    void SetProgressCallback(std::function<void()> on_progress);
+
+    // 在渲染线程、绘制之前调用，推进所有请求。返回 true 表示还有未完成的请求，需要继续调度下一帧
+    bool Update(size_t upload_budget = DEFAULT_UPLOAD_BUDGET);
+
+    size_t PendingCount() const
+    {
+        return pending_;
+    }
+
+    Stats GetStats() const;
+
+private:
+    enum class Stage
+    {
+        Decoded,
+        Filled,
+        Failed,
+    };
+
+    struct Job
+    {
+        std::string path;
+        bool flip_vertically = false;
+        std::optional<MipOptions> mip_options;
+        bool compress = false;
+        Callback on_ready;
+        Stage stage = Stage::Failed;
+        StreamedImage image;
+        // 第 0 级，压缩后换成压缩块
+        std::shared_ptr<uint8_t> pixels;
+        std::vector<MipLevel> mips;
+        // mips[i] 在 PBO 里的偏移，第 0 级在最前面
+        std::vector<size_t> mip_offsets;
+        size_t size = 0;
+        GLuint pbo = 0;
+        void* mapped = nullptr;
+    };
+
+    void Decode(std::shared_ptr<Job> job);
+    void Fill(std::shared_ptr<Job> job);
+    void Post(std::shared_ptr<Job> job);
+    // 映射失败时 job 保留 CPU 像素，从内存上传
+    void Map(std::shared_ptr<Job> job);
+    void Upload(Job& job);
+    GLuint AcquireBuffer();
+    void ReleaseBuffer(GLuint pbo);
+
+private:
+    std::function<void()> on_progress_;
+    std::vector<GLuint> free_buffers_;
+    size_t pending_ = 0;
+    Stats stats_;
+    std::atomic<int64_t> decode_us_{0};
+    std::atomic<int64_t> mip_us_{0};
+    std::atomic<int64_t> compress_us_{0};
+
+    // 工作线程产出，渲染线程消费
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Job>> ready_;
+
+    // 放在最后：析构时先于其他成员等待工作线程结束
+    ThreadPool pool_;
+};
+
+} // namespace utils
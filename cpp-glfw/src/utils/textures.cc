@@ -1,5 +1,535 @@
 #include "textures.h"
+#include "block_compression.h"
+#include "cooked_texture.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "stb_image/stb_image.h"
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <unordered_set>
+#include <vector>
 
 namespace utils {
 
-} // namespace utils
\ No newline at end of file
+namespace {
+
+uint64_t HashOptions(TextureOptions const& options)
+{
+    uint64_t bits = static_cast<uint64_t>(options.flip_vertically) | static_cast<uint64_t>(options.mipmaps) << 1 |
+                    static_cast<uint64_t>(static_cast<uint32_t>(options.wrap) & 0xFFFF) << 2 |
+                    static_cast<uint64_t>(static_cast<uint32_t>(options.min_filter) & 0xFFFF) << 18 |
+                    static_cast<uint64_t>(static_cast<uint32_t>(options.mag_filter) & 0xFFFF) << 34 |
+                    static_cast<uint64_t>(options.cpu_mipmaps) << 50 |
+                    static_cast<uint64_t>(options.mip_options.filter) << 51 |
+                    static_cast<uint64_t>(options.mip_options.srgb) << 53 |
+                    static_cast<uint64_t>(options.mip_options.premultiplied_alpha) << 54 |
+                    static_cast<uint64_t>(options.compress) << 55;
+    return bits * 0x9E3779B97F4A7C15ull;
+}
+
+// 完整的 mipmap 链约为第 0 级的 4/3
+size_t EstimateGpuBytes(int width, int height, int bytes_per_pixel, bool mipmaps)
+{
+    size_t total = 0;
+    size_t level_width = static_cast<size_t>(width);
+    size_t level_height = static_cast<size_t>(height);
+    while (true)
+    {
+        total += level_width * level_height * static_cast<size_t>(bytes_per_pixel);
+        if (!mipmaps || (level_width == 1 && level_height == 1))
+        {
+            break;
+        }
+        level_width = std::max<size_t>(1, level_width / 2);
+        level_height = std::max<size_t>(1, level_height / 2);
+    }
+    return total;
+}
+
+// 驱动是否支持 GL_EXT_texture_compression_s3tc，需要在 GL 上下文创建之后调用
+bool BlockCompressionSupported()
+{
+    static const bool supported = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") != 0;
+    return supported;
+}
+
+using TexStorage2DProc = void(APIENTRYP)(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width,
+                                         GLsizei height);
+
+// glTexStorage2D 是 GL 4.2 的函数，3.3 上下文只在有 GL_ARB_texture_storage 时才能用，需要在 GL 上下文创建之后调用
+TexStorage2DProc GetTexStorage2D()
+{
+    static const TexStorage2DProc tex_storage = []() -> TexStorage2DProc {
+        if (GLAD_GL_VERSION_4_2)
+        {
+            return glad_glTexStorage2D;
+        }
+        if (!glfwExtensionSupported("GL_ARB_texture_storage"))
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<TexStorage2DProc>(glfwGetProcAddress("glTexStorage2D"));
+    }();
+    return tex_storage;
+}
+
+} // namespace
+
+void AllocateTexture2D(GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height)
+{
+    if (TexStorage2DProc tex_storage = GetTexStorage2D())
+    {
+        // 不可变存储，驱动不需要为之后可能的重新定义做准备
+        tex_storage(GL_TEXTURE_2D, levels, internal_format, width, height);
+        return;
+    }
+
+    // 逐级定义内容未定义的图像，效果相同，只是驱动要等到第一次使用时才能确定纹理是否完整
+    bool compressed = CompressedImageSize(internal_format, width, height) != 0;
+    for (GLsizei level = 0; level < levels; ++level)
+    {
+        if (compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format, width, height, 0,
+                                   static_cast<GLsizei>(CompressedImageSize(internal_format, width, height)), nullptr);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(internal_format), width, height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+TextureFormat TextureFormatForChannels(int channels)
+{
+    switch (channels)
+    {
+    case 1:
+        return {GL_R8, GL_RED, 1};
+    case 2:
+        return {GL_RG8, GL_RG, 2};
+    case 3:
+        return {GL_RGB8, GL_RGB, 3};
+    default:
+        return {GL_RGBA8, GL_RGBA, 4};
+    }
+}
+
+void UploadTexture2D(GLuint texture, int width, int height, int channels, const uint8_t* pixels)
+{
+    TextureFormat format = TextureFormatForChannels(channels);
+
+    // RGB / 单通道图片的行不一定是 4 字节对齐的
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format.internal_format), width, height, 0, format.format,
+                 GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+Texture::Texture(GLuint id, int width, int height, int channels, size_t gpu_bytes, bool ready)
+    : id_(id)
+    , width_(width)
+    , height_(height)
+    , channels_(channels)
+    , gpu_bytes_(gpu_bytes)
+    , ready_(ready)
+{
+}
+
+Texture::~Texture()
+{
+    GLStateCache::Current().DeleteTextures(1, &id_);
+}
+
+TextureManager::TextureManager() = default;
+
+TextureManager::~TextureManager() = default;
+
+TextureHandle TextureManager::Load(std::string const& path, TextureOptions const& options)
+{
+    std::string path_key = PathKey(path, options);
+    if (auto it = by_path_.find(path_key); it != by_path_.end())
+    {
+        if (TextureHandle texture = it->second.lock())
+        {
+            ++path_hits_;
+            return texture;
+        }
+    }
+
+    // 读出整个文件：既用来算内容哈希，也直接从内存解码
+    std::vector<uint8_t> file_data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            std::cout << "ERROR: Load image failed: " << path << "\n";
+            return nullptr;
+        }
+        file_data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    uint64_t content_key = ContentKey(Fnv1a64(file_data.data(), file_data.size()), options);
+    if (auto it = by_content_.find(content_key); it != by_content_.end())
+    {
+        if (TextureHandle texture = it->second.lock())
+        {
+            ++content_hits_;
+            by_path_[path_key] = texture;
+            return texture;
+        }
+    }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    uint8_t* pixels = nullptr;
+    {
+        PROFILE_ZONE("stbi_load");
+        stbi_set_flip_vertically_on_load_thread(options.flip_vertically);
+        pixels = stbi_load_from_memory(file_data.data(), static_cast<int>(file_data.size()), &width, &height,
+                                       &channels, 0);
+    }
+    if (!pixels)
+    {
+        std::cout << "ERROR: Load image failed: " << path << " (" << stbi_failure_reason() << ")\n";
+        return nullptr;
+    }
+    ++decoded_;
+
+    auto texture = std::make_shared<Texture>(CreateTexture(options), 0, 0, 0, 0);
+    SpecifyImage(*texture, pixels, width, height, channels, options);
+    stbi_image_free(pixels);
+
+    by_path_[path_key] = texture;
+    by_content_[content_key] = texture;
+    return texture;
+}
+
+TextureHandle TextureManager::LoadCooked(std::string const& path, TextureOptions const& options)
+{
+    std::string path_key = PathKey(path, options);
+    if (auto it = by_path_.find(path_key); it != by_path_.end())
+    {
+        if (TextureHandle texture = it->second.lock())
+        {
+            ++path_hits_;
+            return texture;
+        }
+    }
+
+    MappedFile file;
+    cooked_texture::View view;
+    std::string error;
+    if (!file.Open(path))
+    {
+        std::cout << "ERROR: Load cooked texture failed: " << path << "\n";
+        return nullptr;
+    }
+    if (!cooked_texture::Parse(file.Data(), file.Size(), view, &error))
+    {
+        std::cout << "ERROR: Load cooked texture failed: " << path << " (" << error << ")\n";
+        return nullptr;
+    }
+
+    cooked_texture::Header const& header = *view.header;
+    bool flipped = (header.flags & cooked_texture::FLIPPED_VERTICALLY) != 0;
+    if (flipped != options.flip_vertically)
+    {
+        std::cout << "WARNING: " << path << " was cooked " << (flipped ? "with" : "without")
+                  << " vertical flip, ignoring flip_vertically\n";
+    }
+    // 返回空时 LoadCookedOrAsync 会退回解码源图片
+    if (header.format != 0 && !BlockCompressionSupported())
+    {
+        std::cout << "ERROR: Load cooked texture failed: " << path << " (S3TC is not supported by the driver)\n";
+        return nullptr;
+    }
+
+    // 内容哈希在烘焙时记录的是源图片的，可以和直接加载的同一张图片去重（按文件实际的朝向）
+    TextureOptions cooked_options = options;
+    cooked_options.flip_vertically = flipped;
+    cooked_options.compress = header.format != 0;
+    uint64_t content_key = ContentKey(header.content_hash, cooked_options);
+    if (auto it = by_content_.find(content_key); it != by_content_.end())
+    {
+        if (TextureHandle texture = it->second.lock())
+        {
+            ++content_hits_;
+            by_path_[path_key] = texture;
+            return texture;
+        }
+    }
+
+    PROFILE_ZONE("TextureManager::LoadCooked");
+    int channels = static_cast<int>(header.channels);
+    TextureFormat format = TextureFormatForChannels(channels);
+    GLenum internal_format = header.format != 0 ? static_cast<GLenum>(header.format) : format.internal_format;
+    uint32_t level_count = options.mipmaps ? header.level_count : 1;
+    GLsizei width = static_cast<GLsizei>(header.width);
+    GLsizei height = static_cast<GLsizei>(header.height);
+
+    auto texture = std::make_shared<Texture>(CreateTexture(options), width, height, channels, 0);
+    AllocateTexture2D(static_cast<GLsizei>(level_count), internal_format, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(level_count - 1));
+    // 单通道、双通道的行不一定是 4 字节对齐的
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        cooked_texture::Level const& info = view.levels[level];
+        if (header.format != 0)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, static_cast<GLsizei>(info.width),
+                                      static_cast<GLsizei>(info.height), internal_format,
+                                      static_cast<GLsizei>(info.size), view.LevelPixels(level));
+        }
+        else
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, static_cast<GLsizei>(info.width),
+                            static_cast<GLsizei>(info.height), format.format, GL_UNSIGNED_BYTE,
+                            view.LevelPixels(level));
+        }
+        texture->gpu_bytes_ += static_cast<size_t>(info.size);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    by_path_[path_key] = texture;
+    by_content_[content_key] = texture;
+    return texture;
+}
+
+TextureHandle TextureManager::LoadCookedOrAsync(std::string const& cooked_path, std::string const& source_path,
+                                                TextureOptions const& options)
+{
+    std::error_code ec;
+    if (std::filesystem::exists(cooked_path, ec))
+    {
+        if (TextureHandle texture = LoadCooked(cooked_path, options))
+        {
+            return texture;
+        }
+    }
+    return LoadAsync(source_path, options);
+}
+
+TextureHandle TextureManager::LoadAsync(std::string const& path, TextureOptions const& options)
+{
+    std::string path_key = PathKey(path, options);
+    if (auto it = by_path_.find(path_key); it != by_path_.end())
+    {
+        if (TextureHandle texture = it->second.lock())
+        {
+            ++path_hits_;
+            return texture;
+        }
+    }
+
+    // 占位纹理：1x1 透明，本身就是完整的 mipmap 链
+    static constexpr uint8_t PLACEHOLDER[4] = {0, 0, 0, 0};
+    auto texture = std::make_shared<Texture>(CreateTexture(options), 0, 0, 0, 0, false);
+    SpecifyImage(*texture, PLACEHOLDER, 1, 1, 4, options);
+    by_path_[path_key] = texture;
+
+    // 驱动不支持时按未压缩处理，内容去重的键也要跟实际格式一致
+    TextureOptions stream_options = options;
+    stream_options.compress = options.compress && BlockCompressionSupported();
+    std::weak_ptr<Texture> target = texture;
+    auto on_ready = [this, target, options = stream_options](StreamedImage const& image) {
+        std::shared_ptr<Texture> texture = target.lock();
+        // 加载完成之前所有句柄都已经释放
+        if (!texture || !image.decoded)
+        {
+            return;
+        }
+
+        ++decoded_;
+        if (image.compressed_format != 0)
+        {
+            SpecifyCompressedImage(*texture, image);
+        }
+        else if (image.mip_levels.empty())
+        {
+            SpecifyImage(*texture, image.pixels, image.width, image.height, image.channels, options);
+        }
+        else
+        {
+            TextureOptions base_options = options;
+            base_options.mipmaps = false;
+            SpecifyImage(*texture, image.pixels, image.width, image.height, image.channels, base_options);
+            SpecifyMipLevels(*texture, image.mip_levels);
+        }
+        texture->ready_ = true;
+        uint64_t content_key = ContentKey(image.content_hash, options);
+        if (by_content_[content_key].expired())
+        {
+            by_content_[content_key] = texture;
+        }
+    };
+    std::optional<MipOptions> mips;
+    if (options.mipmaps && (options.cpu_mipmaps || stream_options.compress))
+    {
+        mips = options.mip_options;
+    }
+    Streamer().Request(path, options.flip_vertically, std::move(on_ready), mips, stream_options.compress);
+    return texture;
+}
+
+bool TextureManager::Update()
+{
+    return streamer_ && streamer_->Update();
+}
+
+void TextureManager::SetStreamingCallback(std::function<void()> on_progress)
+{
+    on_progress_ = std::move(on_progress);
+    if (streamer_)
+    {
+        streamer_->SetProgressCallback(on_progress_);
+    }
+}
+
+TextureManager::Stats TextureManager::GetStats() const
+{
+    Stats stats;
+    stats.decoded = decoded_;
+    stats.path_hits = path_hits_;
+    stats.content_hits = content_hits_;
+
+    stats.loading = streamer_ ? streamer_->PendingCount() : 0;
+
+    // 同一个纹理可能同时登记在两个表里（异步加载中的只在 by_path_ 里），按对象去重
+    std::unordered_set<Texture const*> counted;
+    auto count = [&](std::weak_ptr<Texture const> const& entry) {
+        if (TextureHandle texture = entry.lock(); texture && counted.insert(texture.get()).second)
+        {
+            ++stats.live_textures;
+            stats.gpu_bytes += texture->GpuBytes();
+        }
+    };
+    for (auto const& [key, entry] : by_path_)
+    {
+        count(entry);
+    }
+    for (auto const& [key, entry] : by_content_)
+    {
+        if (TextureHandle texture = entry.lock(); texture && counted.insert(texture.get()).second)
+        {
+            ++stats.live_textures;
+            stats.gpu_bytes += texture->GpuBytes();
+        }
+    }
+    return stats;
+}
+
+std::string TextureManager::PathKey(std::string const& path, TextureOptions const& options)
+{
+    return path + '#' + std::to_string(HashOptions(options));
+}
+
+uint64_t TextureManager::ContentKey(uint64_t content_hash, TextureOptions const& options)
+{
+    return content_hash ^ HashOptions(options);
+}
+
+GLuint TextureManager::CreateTexture(TextureOptions const& options)
+{
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.min_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.mag_filter);
+    return id;
+}
+
+void TextureManager::SpecifyImage(Texture& texture, const void* pixels, int width, int height, int channels,
+                                  TextureOptions const& options)
+{
+    PROFILE_ZONE("TextureManager::SpecifyImage");
+    TextureFormat format = TextureFormatForChannels(channels);
+
+    // 异步上传时 pixels 是当前绑定的 GL_PIXEL_UNPACK_BUFFER 内的偏移
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, texture.id_);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format.internal_format), width, height, 0, format.format,
+                 GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (options.mipmaps)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    texture.width_ = width;
+    texture.height_ = height;
+    texture.channels_ = channels;
+    texture.gpu_bytes_ = EstimateGpuBytes(width, height, format.bytes_per_pixel, options.mipmaps);
+}
+
+void TextureManager::SpecifyMipLevels(Texture& texture, std::vector<StreamedLevel> const& levels)
+{
+    PROFILE_ZONE("TextureManager::SpecifyMipLevels");
+    TextureFormat format = TextureFormatForChannels(texture.channels_);
+
+    // 与 SpecifyImage 相同，pixels 可能是 PBO 内的偏移
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, texture.id_);
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        StreamedLevel const& level = levels[i];
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), static_cast<GLint>(format.internal_format),
+                     level.width, level.height, 0, format.format, GL_UNSIGNED_BYTE, level.pixels);
+        texture.gpu_bytes_ += static_cast<size_t>(level.width) * level.height * format.bytes_per_pixel;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()));
+}
+
+void TextureManager::SpecifyCompressedImage(Texture& texture, StreamedImage const& image)
+{
+    PROFILE_ZONE("TextureManager::SpecifyCompressedImage");
+    GLenum internal_format = image.compressed_format;
+
+    // 与 SpecifyImage 相同，pixels 可能是 PBO 内的偏移；压缩数据不受 GL_UNPACK_ALIGNMENT 影响
+    GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, texture.id_);
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0,
+                           static_cast<GLsizei>(image.size), image.pixels);
+    texture.gpu_bytes_ = image.size;
+    for (size_t i = 0; i < image.mip_levels.size(); ++i)
+    {
+        StreamedLevel const& level = image.mip_levels[i];
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), internal_format, level.width, level.height,
+                               0, static_cast<GLsizei>(level.size), level.pixels);
+        texture.gpu_bytes_ += level.size;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mip_levels.size()));
+
+    texture.width_ = image.width;
+    texture.height_ = image.height;
+    texture.channels_ = image.channels;
+}
+
+TextureStreamer& TextureManager::Streamer()
+{
+    if (!streamer_)
+    {
+        streamer_ = std::make_unique<TextureStreamer>();
+        streamer_->SetProgressCallback(on_progress_);
+    }
+    return *streamer_;
+}
+
+} // namespace utils
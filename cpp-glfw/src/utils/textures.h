@@ -1,5 +1,184 @@
 #pragma once
 
+#include "gl_include.h"
+#include "mip_generator.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace utils {
 
-} // namespace utils
\ No newline at end of file
+// 按通道数选择的纹理格式
+struct TextureFormat
+{
+    GLenum internal_format = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    int bytes_per_pixel = 4;
+};
+
+TextureFormat TextureFormatForChannels(int channels);
+
+// 按通道数选择格式，上传到 texture 的第 0 级并生成 mipmap（会把它绑定到 0 号纹理单元）
+void UploadTexture2D(GLuint texture, int width, int height, int channels, const uint8_t* pixels);
+
+// 为当前绑定在 GL_TEXTURE_2D 上的纹理分配 levels 级存储，之后用 glTex(Compressed)SubImage2D 填充。
+// 有 GL 4.2 或 GL_ARB_texture_storage 时用 glTexStorage2D，否则（3.3 上下文、macOS 的 4.1）逐级 glTexImage2D
+void AllocateTexture2D(GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height);
+
+struct TextureOptions
+{
+    bool flip_vertically = false;
+    GLint wrap = GL_REPEAT;
+    GLint min_filter = GL_LINEAR;
+    GLint mag_filter = GL_LINEAR;
+    bool mipmaps = true;
+    // LoadAsync 在工作线程上解码之后接着用 mip_options 生成 mipmap 链，渲染线程只逐级上传；
+    // 为 false 或同步加载时在 GPU 上 glGenerateMipmap。烘焙的纹理在烘焙时已经生成好
+    bool cpu_mipmaps = true;
+    MipOptions mip_options;
+    // LoadAsync 在工作线程上把各级压缩成 BC1（不透明）/ BC3（带 alpha），驱动不支持 S3TC 时忽略。
+    // 压缩的纹理不能 glGenerateMipmap，mipmap 总是在 CPU 上生成
+    bool compress = false;
+
+    bool operator==(TextureOptions const&) const = default;
+};
+
+// GL 纹理对象，最后一个引用释放时删除（必须在 GL 上下文销毁之前）
+class Texture
+{
+public:
+    Texture(GLuint id, int width, int height, int channels, size_t gpu_bytes, bool ready = true);
+    ~Texture();
+
+    Texture(Texture const&) = delete;
+    Texture& operator=(Texture const&) = delete;
+
+    GLuint Id() const
+    {
+        return id_;
+    }
+
+    int Width() const
+    {
+        return width_;
+    }
+
+    int Height() const
+    {
+        return height_;
+    }
+
+    int Channels() const
+    {
+        return channels_;
+    }
+
+    // 估算的显存占用（包括 mipmap 链）
+    size_t GpuBytes() const
+    {
+        return gpu_bytes_;
+    }
+
+    // 异步加载完成之前是 1x1 的透明占位纹理，可以照常绑定和绘制
+    bool IsReady() const
+    {
+        return ready_;
+    }
+
+private:
+    friend class TextureManager;
+
+    GLuint id_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 0;
+    size_t gpu_bytes_ = 0;
+    bool ready_ = true;
+};
+
+// 引用计数的纹理句柄，空表示加载失败
+using TextureHandle = std::shared_ptr<Texture const>;
+
+class TextureStreamer;
+struct StreamedLevel;
+struct StreamedImage;
+
+// 纹理缓存：同一路径只加载一次；不同路径但文件内容相同（按内容哈希）的图片也只解码、上传一次。
+// 缓存只持有弱引用，所有句柄释放后纹理随之删除，再次加载时重新解码。
+class TextureManager
+{
+public:
+    TextureManager();
+    // 必须在 GL 上下文销毁前析构
+    ~TextureManager();
+
+    TextureManager(TextureManager const&) = delete;
+    TextureManager& operator=(TextureManager const&) = delete;
+
+    struct Stats
+    {
+        // 当前存活的纹理数和显存占用
+        size_t live_textures = 0;
+        size_t gpu_bytes = 0;
+        // 累计解码次数，以及按路径 / 按内容命中缓存的次数
+        uint64_t decoded = 0;
+        uint64_t path_hits = 0;
+        uint64_t content_hits = 0;
+        // 正在异步加载的纹理数
+        size_t loading = 0;
+    };
+
+    // 同步读取、解码并上传，失败时返回空
+    TextureHandle Load(std::string const& path, TextureOptions const& options = {});
+
+    // 加载 texture-cooker 生成的 .gltex：映射文件后逐级上传，不解码也不生成 mipmap
+    // （options.mipmaps 为 false 时只上传第 0 级）。像素朝向在烘焙时已经确定，
+    // 与 options.flip_vertically 不一致时只给出警告。失败（包括压缩过的文件而驱动不支持 S3TC）时返回空
+    TextureHandle LoadCooked(std::string const& path, TextureOptions const& options = {});
+
+    // 优先加载烘焙好的版本，不存在或无效时退回异步解码源图片
+    TextureHandle LoadCookedOrAsync(std::string const& cooked_path, std::string const& source_path,
+                                    TextureOptions const& options = {});
+
+    // 立即返回占位纹理，在工作线程解码，之后由 Update() 通过 PBO 上传到同一个纹理对象。
+    // 异步加载只能按路径去重，内容哈希在解码之后才知道，此后的 Load 可以按内容命中
+    TextureHandle LoadAsync(std::string const& path, TextureOptions const& options = {});
+
+    // 在渲染线程、绘制之前调用，推进异步加载。返回 true 表示还有纹理在加载，需要继续调度下一帧
+    bool Update();
+
+    // 有异步加载需要 Update() 处理时在工作线程上调用，OnDemand 模式下用来唤醒消息循环
+    void SetStreamingCallback(std::function<void()> on_progress);
+
+    Stats GetStats() const;
+
+private:
+    // 同一张图片用不同的采样参数或翻转方式加载时是不同的纹理
+    static std::string PathKey(std::string const& path, TextureOptions const& options);
+    static uint64_t ContentKey(uint64_t content_hash, TextureOptions const& options);
+    static GLuint CreateTexture(TextureOptions const& options);
+    // 上传第 0 级并按需生成 mipmap，更新尺寸和显存占用
+    static void SpecifyImage(Texture& texture, const void* pixels, int width, int height, int channels,
+                             TextureOptions const& options);
+    // 上传工作线程生成好的第 1 级到 1x1 的各级，代替 glGenerateMipmap
+    static void SpecifyMipLevels(Texture& texture, std::vector<StreamedLevel> const& levels);
+    // 上传工作线程压缩好的各级
+    static void SpecifyCompressedImage(Texture& texture, StreamedImage const& image);
+    TextureStreamer& Streamer();
+
+private:
+    std::unordered_map<std::string, std::weak_ptr<Texture const>> by_path_;
+    std::unordered_map<uint64_t, std::weak_ptr<Texture const>> by_content_;
+    uint64_t decoded_ = 0;
+    uint64_t path_hits_ = 0;
+    uint64_t content_hits_ = 0;
+    std::function<void()> on_progress_;
+    // 第一次异步加载时才创建工作线程
+    std::unique_ptr<TextureStreamer> streamer_;
+};
+
+} // namespace utils
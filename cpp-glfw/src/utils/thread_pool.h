@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+// 固定数量工作线程的任务池，任务按提交顺序开始执行
+class ThreadPool
+{
+public:
+    // thread_count 为 0 时使用 硬件线程数 - 1（至少 1 个），给渲染线程留一个核
+    explicit ThreadPool(size_t thread_count = 0);
+    // 等待已经提交的任务全部执行完
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    // 可以在任意线程（包括任务内部）调用
+    void Submit(std::function<void()> task);
+    // 阻塞到队列为空且没有正在执行的任务；不要在任务内部调用
+    void WaitIdle();
+
+    size_t ThreadCount() const
+    {
+        return workers_.size();
+    }
+
+private:
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> tasks_;
+    size_t running_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace utils
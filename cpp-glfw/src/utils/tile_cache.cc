@@ -0,0 +1,333 @@
+#include "tile_cache.h"
+#include "gl_state.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace utils {
+
+namespace {
+
+bool Fail(std::string* error, std::string message)
+{
+    if (error)
+    {
+        *error = std::move(message);
+    }
+    return false;
+}
+
+} // namespace
+
+TileCache::TileCache(TileCacheOptions const& options) : options_(options), pool_(options.thread_count)
+{
+}
+
+TileCache::~TileCache()
+{
+    pool_.WaitIdle();
+}
+
+bool TileCache::Open(std::string const& path, std::string* error)
+{
+    PROFILE_ZONE("TileCache::Open");
+    // 之前打开的图片可能还有读取没结束
+    pool_.WaitIdle();
+    loaded_.clear();
+    in_flight_.clear();
+    entries_.clear();
+    lru_.clear();
+    wanted_.clear();
+    texture_.reset();
+    stats_ = {};
+
+    // 几个 GB 的金字塔每次只看其中几块瓦片，不能整个预读
+    if (!file_.Open(path, MappedAccess::Random))
+    {
+        return Fail(error, "cannot open " + path);
+    }
+    if (!tiled_image::Parse(file_.Data(), file_.Size(), view_, error))
+    {
+        file_.Close();
+        return false;
+    }
+
+    slot_size_ = view_.SlotSize();
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    slots_per_row_ = std::min(options_.texture_size, static_cast<int>(max_size)) / slot_size_;
+    if (slots_per_row_ < 2)
+    {
+        file_.Close();
+        return Fail(error, "tiles are too large for the cache texture");
+    }
+    texture_size_ = slots_per_row_ * slot_size_;
+
+    auto& gl_state = GLStateCache::Current();
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    gl_state.BindTextureForUpdate(0, GL_TEXTURE_2D, id);
+    // 只有一级：槽位之间只隔着瓦片自带的边框，缩小的 mipmap 会混入相邻的槽位，缩小由选择级别代替
+    AllocateTexture2D(1, GL_RGBA8, texture_size_, texture_size_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options_.mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    texture_ = std::make_shared<Texture>(id, texture_size_, texture_size_, 4,
+                                         static_cast<size_t>(texture_size_) * texture_size_ * 4);
+
+    int capacity = slots_per_row_ * slots_per_row_;
+    free_slots_.clear();
+    for (int slot = capacity - 1; slot >= 0; --slot)
+    {
+        free_slots_.push_back(slot);
+    }
+    stats_.capacity = static_cast<size_t>(capacity);
+
+    // 最粗的一级只有一块瓦片，同步上传，之后任何位置都至少有它可以代替
+    int top = LevelCount() - 1;
+    tiled_image::Level const& info = view_.levels[top];
+    for (uint32_t y = 0; y < info.tiles_y; ++y)
+    {
+        for (uint32_t x = 0; x < info.tiles_x; ++x)
+        {
+            Insert(MakeKey(top, static_cast<int>(x), static_cast<int>(y)), view_.TilePixels(top, x, y), true);
+        }
+    }
+    return true;
+}
+
+void TileCache::Collect(double x0, double y0, double x1, double y1, double scale, std::vector<TileQuad>& quads)
+{
+    PROFILE_ZONE("TileCache::Collect");
+    ++frame_;
+    wanted_.clear();
+    stats_.fallbacks = 0;
+    if (!texture_)
+    {
+        return;
+    }
+
+    x0 = std::max(x0, 0.0);
+    y0 = std::max(y0, 0.0);
+    x1 = std::min(x1, static_cast<double>(Width()));
+    y1 = std::min(y1, static_cast<double>(Height()));
+    if (x0 >= x1 || y0 >= y1 || scale <= 0.0)
+    {
+        return;
+    }
+
+    // 第 level 级的一个像素在屏幕上占 scale * 2^level 个像素，选最接近 1 的一级
+    int top = LevelCount() - 1;
+    int level = std::clamp(static_cast<int>(std::lround(-std::log2(scale))), 0, top);
+    tiled_image::Level const& info = view_.levels[level];
+    double tile_extent = std::ldexp(static_cast<double>(view_.header->tile_size), level);
+    int first_x = static_cast<int>(x0 / tile_extent);
+    int first_y = static_cast<int>(y0 / tile_extent);
+    int last_x = std::min(static_cast<int>(info.tiles_x) - 1, static_cast<int>(x1 / tile_extent));
+    int last_y = std::min(static_cast<int>(info.tiles_y) - 1, static_cast<int>(y1 / tile_extent));
+
+    // 从中间往外：先请求的先加载
+    struct Visible
+    {
+        int x;
+        int y;
+        double distance;
+    };
+    std::vector<Visible> visible;
+    double center_x = (x0 + x1) * 0.5 / tile_extent - 0.5;
+    double center_y = (y0 + y1) * 0.5 / tile_extent - 0.5;
+    for (int y = first_y; y <= last_y; ++y)
+    {
+        for (int x = first_x; x <= last_x; ++x)
+        {
+            double dx = x - center_x;
+            double dy = y - center_y;
+            visible.push_back({x, y, dx * dx + dy * dy});
+        }
+    }
+    std::sort(visible.begin(), visible.end(),
+              [](Visible const& a, Visible const& b) { return a.distance < b.distance; });
+
+    // 缺父级的先加载父级：覆盖的面积大，很快就能把最粗一级的模糊画面换掉
+    std::vector<uint64_t> wanted_parents;
+    int border = static_cast<int>(view_.header->border);
+    double texel = 1.0 / texture_size_;
+    for (Visible const& tile : visible)
+    {
+        int found = level;
+        auto it = entries_.end();
+        for (; found <= top; ++found)
+        {
+            int shift = found - level;
+            it = entries_.find(MakeKey(found, tile.x >> shift, tile.y >> shift));
+            if (it != entries_.end())
+            {
+                break;
+            }
+        }
+        // 最粗一级常驻并且覆盖整张图片，总能找到
+        if (it == entries_.end())
+        {
+            continue;
+        }
+        if (found != level)
+        {
+            ++stats_.fallbacks;
+            wanted_.push_back(MakeKey(level, tile.x, tile.y));
+            if (found > level + 1)
+            {
+                uint64_t parent = MakeKey(level + 1, tile.x >> 1, tile.y >> 1);
+                if (std::find(wanted_parents.begin(), wanted_parents.end(), parent) == wanted_parents.end())
+                {
+                    wanted_parents.push_back(parent);
+                }
+            }
+        }
+        Entry* entry = Touch(it->first);
+
+        TileQuad quad;
+        quad.x0 = tile.x * tile_extent;
+        quad.y0 = tile.y * tile_extent;
+        quad.x1 = std::min(quad.x0 + tile_extent, static_cast<double>(Width()));
+        quad.y1 = std::min(quad.y0 + tile_extent, static_cast<double>(Height()));
+
+        // 图片坐标换算到第 found 级，再换算到所在槽位里的纹素，全程用 double，最后的纹理坐标才是 float
+        int shift = found - level;
+        double found_scale = std::ldexp(1.0, -found);
+        double origin_x = (entry->slot % slots_per_row_) * slot_size_ + border -
+                          static_cast<double>(tile.x >> shift) * view_.header->tile_size;
+        double origin_y = (entry->slot / slots_per_row_) * slot_size_ + border -
+                          static_cast<double>(tile.y >> shift) * view_.header->tile_size;
+        quad.u0 = static_cast<float>((origin_x + quad.x0 * found_scale) * texel);
+        quad.v0 = static_cast<float>((origin_y + quad.y0 * found_scale) * texel);
+        quad.u1 = static_cast<float>((origin_x + quad.x1 * found_scale) * texel);
+        quad.v1 = static_cast<float>((origin_y + quad.y1 * found_scale) * texel);
+        quads.push_back(quad);
+    }
+    wanted_.insert(wanted_.begin(), wanted_parents.begin(), wanted_parents.end());
+}
+
+bool TileCache::Update()
+{
+    PROFILE_ZONE("TileCache::Update");
+    std::vector<LoadedTile> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = std::min(loaded_.size(), static_cast<size_t>(std::max(options_.uploads_per_frame, 1)));
+        std::move(loaded_.begin(), loaded_.begin() + static_cast<std::ptrdiff_t>(count), std::back_inserter(loaded));
+        loaded_.erase(loaded_.begin(), loaded_.begin() + static_cast<std::ptrdiff_t>(count));
+    }
+    bool uploaded = false;
+    for (LoadedTile const& tile : loaded)
+    {
+        in_flight_.erase(tile.key);
+        // 缓存满时丢掉，下一帧仍然可见的话会重新请求
+        if (entries_.find(tile.key) == entries_.end() && Insert(tile.key, tile.pixels.data(), false))
+        {
+            ++stats_.loaded;
+            uploaded = true;
+        }
+    }
+
+    for (uint64_t key : wanted_)
+    {
+        if (in_flight_.size() >= static_cast<size_t>(std::max(options_.max_in_flight, 1)))
+        {
+            break;
+        }
+        if (entries_.find(key) != entries_.end() || !in_flight_.insert(key).second)
+        {
+            continue;
+        }
+        pool_.Submit([this, key] { Load(key); });
+    }
+    return uploaded || !in_flight_.empty();
+}
+
+TileCache::Stats TileCache::GetStats() const
+{
+    Stats stats = stats_;
+    stats.resident = entries_.size();
+    stats.in_flight = in_flight_.size();
+    return stats;
+}
+
+TileCache::Entry* TileCache::Touch(uint64_t key)
+{
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+    {
+        return nullptr;
+    }
+    Entry& entry = it->second;
+    entry.last_used = frame_;
+    if (!entry.pinned)
+    {
+        lru_.splice(lru_.begin(), lru_, entry.lru);
+    }
+    return &entry;
+}
+
+bool TileCache::Insert(uint64_t key, const uint8_t* pixels, bool pinned)
+{
+    int slot = 0;
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        // 最久没用的一块本帧也在用时，说明可见的瓦片比槽位还多
+        if (lru_.empty())
+        {
+            return false;
+        }
+        auto victim = entries_.find(lru_.back());
+        if (victim->second.last_used == frame_)
+        {
+            return false;
+        }
+        slot = victim->second.slot;
+        lru_.pop_back();
+        entries_.erase(victim);
+        ++stats_.evicted;
+    }
+
+    Entry entry;
+    entry.slot = slot;
+    entry.last_used = frame_;
+    entry.pinned = pinned;
+    if (!pinned)
+    {
+        lru_.push_front(key);
+        entry.lru = lru_.begin();
+    }
+    entries_[key] = entry;
+
+    GLStateCache::Current().BindTextureForUpdate(0, GL_TEXTURE_2D, texture_->Id());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot % slots_per_row_ * slot_size_, slot / slots_per_row_ * slot_size_,
+                    slot_size_, slot_size_, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    return true;
+}
+
+void TileCache::Load(uint64_t key)
+{
+    PROFILE_ZONE("TileCache::Load");
+    auto level = static_cast<uint32_t>(key >> 56);
+    auto y = static_cast<uint32_t>(key >> 28 & 0xFFFFFFF);
+    auto x = static_cast<uint32_t>(key & 0xFFFFFFF);
+    // 第一次访问映射的页时才从磁盘读入，放在工作线程上，渲染线程不会因为缺页卡住
+    const uint8_t* pixels = view_.TilePixels(level, x, y);
+    LoadedTile tile{key, std::vector<uint8_t>(pixels, pixels + view_.TileBytes())};
+    std::lock_guard<std::mutex> lock(mutex_);
+    loaded_.push_back(std::move(tile));
+}
+
+} // namespace utils
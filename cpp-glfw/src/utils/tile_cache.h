@@ -0,0 +1,156 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "textures.h"
+#include "thread_pool.h"
+#include "tiled_image.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace utils {
+
+struct TileCacheOptions
+{
+    // 缓存纹理的边长，按 GL_MAX_TEXTURE_SIZE 截断后向下取整为瓦片（含边框）大小的倍数
+    int texture_size = 4096;
+    // 每帧最多上传的瓦片数
+    int uploads_per_frame = 8;
+    // 同时在工作线程上读取的瓦片数
+    int max_in_flight = 16;
+    // 0 时见 ThreadPool
+    size_t thread_count = 0;
+    GLint mag_filter = GL_LINEAR;
+};
+
+// 绘制一块瓦片的矩形：图片像素坐标（第 0 级）和缓存纹理里对应的纹理坐标。
+// 十亿像素的图片坐标超过 float 能精确表示的范围，位置用 double，由调用方减去视野中心后再转换
+struct TileQuad
+{
+    double x0 = 0.0;
+    double y0 = 0.0;
+    double x1 = 0.0;
+    double y1 = 0.0;
+    float u0 = 0.0f;
+    float v0 = 0.0f;
+    float u1 = 0.0f;
+    float v1 = 0.0f;
+};
+
+// 查看 .gltiles 分块金字塔的 GPU 瓦片缓存（格式见 utils/tiled_image.h）。
+// 一张固定大小的 RGBA8 纹理划分成若干槽位，只有当前可见、所需级别的瓦片常驻，满了按 LRU 淘汰。
+// 映射的文件在工作线程上按需读取（缺页也发生在工作线程上），渲染线程每帧只上传有限的几块。
+// 缺少的瓦片先用已经常驻的更粗一级代替，最粗的一级在 Open() 时同步加载并且不会被淘汰。
+// 除了构造、析构，所有函数都在渲染线程上调用
+class TileCache
+{
+public:
+    struct Stats
+    {
+        size_t resident = 0;
+        size_t capacity = 0;
+        size_t in_flight = 0;
+        uint64_t loaded = 0;
+        uint64_t evicted = 0;
+        // 本帧用更粗一级代替的瓦片数
+        size_t fallbacks = 0;
+    };
+
+    explicit TileCache(TileCacheOptions const& options = {});
+    // 等待工作线程上的读取结束
+    ~TileCache();
+
+    TileCache(TileCache const&) = delete;
+    TileCache& operator=(TileCache const&) = delete;
+
+    // 需要 GL 上下文
+    bool Open(std::string const& path, std::string* error = nullptr);
+
+    int Width() const
+    {
+        return static_cast<int>(view_.header->width);
+    }
+
+    int Height() const
+    {
+        return static_cast<int>(view_.header->height);
+    }
+
+    int LevelCount() const
+    {
+        return static_cast<int>(view_.header->level_count);
+    }
+
+    // 所有瓦片所在的缓存纹理
+    TextureHandle CacheTexture() const
+    {
+        return texture_;
+    }
+
+    // 图片坐标下的可见范围 [x0, x1) x [y0, y1)，scale 是每个图片像素对应的屏幕像素。
+    // 按 scale 选出级别，把覆盖可见范围的瓦片追加到 quads（缺少的用更粗一级代替），缺少的瓦片排队等待加载
+    void Collect(double x0, double y0, double x1, double y1, double scale, std::vector<TileQuad>& quads);
+
+    // 每帧在 Collect 之后调用一次：上传读好的瓦片、为本帧缺少的瓦片发起读取。
+    // 返回 true 表示上传了新的瓦片或者还有瓦片在加载，需要再画一帧
+    bool Update();
+
+    Stats GetStats() const;
+
+private:
+    struct Entry
+    {
+        int slot = 0;
+        uint64_t last_used = 0;
+        // 最粗一级常驻
+        bool pinned = false;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    struct LoadedTile
+    {
+        uint64_t key = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    static uint64_t MakeKey(int level, int x, int y)
+    {
+        return static_cast<uint64_t>(level) << 56 | static_cast<uint64_t>(y) << 28 | static_cast<uint64_t>(x);
+    }
+
+    // 返回常驻的 key 对应的项并标记为本帧使用，不在缓存里时返回 nullptr
+    Entry* Touch(uint64_t key);
+    // 分配槽位并上传，缓存满、所有槽位本帧都在使用时返回 false
+    bool Insert(uint64_t key, const uint8_t* pixels, bool pinned);
+    void Load(uint64_t key);
+
+private:
+    TileCacheOptions options_;
+    MappedFile file_;
+    tiled_image::View view_;
+    std::shared_ptr<Texture> texture_;
+    int slot_size_ = 0;
+    int slots_per_row_ = 0;
+    int texture_size_ = 0;
+    uint64_t frame_ = 0;
+
+    std::unordered_map<uint64_t, Entry> entries_;
+    // 最近使用的在前面
+    std::list<uint64_t> lru_;
+    std::vector<int> free_slots_;
+    // 本帧缺少的瓦片，按优先级排好
+    std::vector<uint64_t> wanted_;
+    std::unordered_set<uint64_t> in_flight_;
+    Stats stats_;
+
+    std::mutex mutex_;
+    std::vector<LoadedTile> loaded_;
+    // 放在最后，最先析构：先等工作线程结束再释放映射
+    ThreadPool pool_;
+};
+
+} // namespace utils
@@ -0,0 +1,558 @@
+#include "tiled_image.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace utils {
+
+namespace tiled_image {
+
+namespace {
+
+// 缩小时两侧多算的目标像素，Kaiser 核的半径是 3 个目标像素，多出来的部分算完就丢掉
+constexpr int FILTER_MARGIN = 4;
+// 缩小时每个任务负责的列数（目标级别的像素）
+constexpr int CHUNK_COLUMNS = 1024;
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool Fail(std::string* error, std::string message)
+{
+    if (error)
+    {
+        *error = std::move(message);
+    }
+    return false;
+}
+
+// 按头部算出各级的尺寸和偏移，Parse 和 Write 共用，文件里的级别表必须和它一致
+std::vector<Level> Layout(uint32_t width, uint32_t height, uint32_t tile_size, size_t tile_bytes)
+{
+    std::vector<Level> levels;
+    while (true)
+    {
+        Level level{};
+        level.width = width;
+        level.height = height;
+        level.tiles_x = (width + tile_size - 1) / tile_size;
+        level.tiles_y = (height + tile_size - 1) / tile_size;
+        levels.push_back(level);
+        if (width <= tile_size && height <= tile_size)
+        {
+            break;
+        }
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+
+    size_t offset = AlignUp(sizeof(Header) + sizeof(Level) * levels.size(), ALIGNMENT);
+    for (Level& level : levels)
+    {
+        level.offset = offset;
+        offset = AlignUp(offset + static_cast<size_t>(level.tiles_x) * level.tiles_y * tile_bytes, ALIGNMENT);
+    }
+    return levels;
+}
+
+size_t LevelEnd(Level const& level, size_t tile_bytes)
+{
+    return level.offset + static_cast<size_t>(level.tiles_x) * level.tiles_y * tile_bytes;
+}
+
+// 某一级连续若干行的 RGBA 像素，行号可以超出图片（内容夹到边缘）
+struct Band
+{
+    int first_row = 0;
+    int rows = 0;
+    int width = 0;
+    std::vector<uint8_t> pixels;
+
+    void Resize(int first, int count, int row_width)
+    {
+        first_row = first;
+        rows = count;
+        width = row_width;
+        pixels.resize(static_cast<size_t>(rows) * width * 4);
+    }
+
+    uint8_t* Row(int y)
+    {
+        return &pixels[static_cast<size_t>(y - first_row) * width * 4];
+    }
+
+    const uint8_t* Row(int y) const
+    {
+        return &pixels[static_cast<size_t>(y - first_row) * width * 4];
+    }
+};
+
+void ConvertRowToRgba(const uint8_t* in, int width, int channels, uint8_t* out)
+{
+    for (int x = 0; x < width; ++x, in += channels, out += 4)
+    {
+        switch (channels)
+        {
+        case 1:
+            out[0] = out[1] = out[2] = in[0];
+            out[3] = 255;
+            break;
+        case 2:
+            out[0] = out[1] = out[2] = in[0];
+            out[3] = in[1];
+            break;
+        case 3:
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+            out[3] = 255;
+            break;
+        default:
+            memcpy(out, in, 4);
+            break;
+        }
+    }
+}
+
+class PyramidWriter
+{
+public:
+    PyramidWriter(std::fstream& file, SourceImage const& source, BuildOptions const& options,
+                  std::vector<Level> const& levels, ThreadPool* pool, size_t written)
+        : written_(written), file_(file), source_(source), options_(options), levels_(levels), pool_(pool),
+          slot_size_(options.tile_size + options.border * 2),
+          tile_bytes_(static_cast<size_t>(slot_size_) * slot_size_ * 4)
+    {
+    }
+
+    bool WriteLevel(uint32_t level)
+    {
+        PROFILE_ZONE("tiled_image::WriteLevel");
+        Level const& info = levels_[level];
+        int tile_size = options_.tile_size;
+        int border = options_.border;
+        Band band;
+        std::vector<uint8_t> tile_row(static_cast<size_t>(info.tiles_x) * tile_bytes_);
+        for (uint32_t ty = 0; ty < info.tiles_y; ++ty)
+        {
+            // 这一行瓦片（含边框）夹到图片内之后覆盖的行
+            int first = std::max(0, static_cast<int>(ty) * tile_size - border);
+            int last = std::min(static_cast<int>(info.height), static_cast<int>(ty + 1) * tile_size + border);
+            if (level == 0)
+            {
+                ReadSourceRows(first, last, band);
+            }
+            else if (!Downsample(level, first, last, band))
+            {
+                return false;
+            }
+            CutTiles(info, ty, band, tile_row.data());
+            if (!WriteAt(info.offset + static_cast<size_t>(ty) * info.tiles_x * tile_bytes_, tile_row.data(),
+                         tile_row.size()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    void ReadSourceRows(int first, int last, Band& band) const
+    {
+        band.Resize(first, last - first, source_.width);
+        size_t stride = static_cast<size_t>(source_.width) * source_.channels;
+        for (int y = first; y < last; ++y)
+        {
+            int source_y = std::clamp(y, 0, source_.height - 1);
+            ConvertRowToRgba(source_.pixels + source_y * stride, source_.width, source_.channels, band.Row(y));
+        }
+    }
+
+    // 从文件里读回已经写好的第 level 级的 [first, last) 行，只读每块瓦片里需要的那几行
+    bool ReadLevelRows(uint32_t level, int first, int last, Band& band)
+    {
+        if (level == 0)
+        {
+            ReadSourceRows(first, last, band);
+            return true;
+        }
+
+        Level const& info = levels_[level];
+        int tile_size = options_.tile_size;
+        int border = options_.border;
+        int height = static_cast<int>(info.height);
+        band.Resize(first, last - first, static_cast<int>(info.width));
+
+        int begin = std::clamp(first, 0, height);
+        int end = std::clamp(last, 0, height);
+        std::vector<uint8_t> rows;
+        for (int ty = begin / tile_size; ty * tile_size < end; ++ty)
+        {
+            int row_begin = std::max(begin, ty * tile_size);
+            int row_end = std::min(end, (ty + 1) * tile_size);
+            size_t row_bytes = static_cast<size_t>(slot_size_) * 4;
+            rows.resize(static_cast<size_t>(row_end - row_begin) * row_bytes);
+            for (uint32_t tx = 0; tx < info.tiles_x; ++tx)
+            {
+                size_t tile_offset = info.offset + (static_cast<size_t>(ty) * info.tiles_x + tx) * tile_bytes_;
+                size_t first_row = static_cast<size_t>(row_begin - ty * tile_size + border);
+                if (!ReadAt(tile_offset + first_row * row_bytes, rows.data(), rows.size()))
+                {
+                    return false;
+                }
+
+                int x = static_cast<int>(tx) * tile_size;
+                int columns = std::min(tile_size, static_cast<int>(info.width) - x);
+                for (int y = row_begin; y < row_end; ++y)
+                {
+                    memcpy(band.Row(y) + static_cast<size_t>(x) * 4,
+                           &rows[static_cast<size_t>(y - row_begin) * row_bytes + static_cast<size_t>(border) * 4],
+                           static_cast<size_t>(columns) * 4);
+                }
+            }
+        }
+
+        // 超出图片的行复制边缘
+        size_t band_row_bytes = static_cast<size_t>(band.width) * 4;
+        for (int y = first; y < last; ++y)
+        {
+            if (y < begin || y >= end)
+            {
+                memcpy(band.Row(y), band.Row(std::clamp(y, begin, end - 1)), band_row_bytes);
+            }
+        }
+        return true;
+    }
+
+    // 第 level 级的 [first, last) 行由上一级的 [2 * first, 2 * last) 行 2:1 缩小得到（上一级按边缘延伸成偶数尺寸）。
+    // 上下左右各多取 FILTER_MARGIN 个目标像素的范围，分段缩小的结果和整张图片一起缩小相同
+    bool Downsample(uint32_t level, int first, int last, Band& band)
+    {
+        PROFILE_ZONE("tiled_image::Downsample");
+        Band previous;
+        if (!ReadLevelRows(level - 1, (first - FILTER_MARGIN) * 2, (last + FILTER_MARGIN) * 2, previous))
+        {
+            return false;
+        }
+
+        int width = static_cast<int>(levels_[level].width);
+        band.Resize(first, last - first, width);
+        auto run = [&](int column_begin, int column_end) {
+            int columns = column_end - column_begin + FILTER_MARGIN * 2;
+            int input_width = columns * 2;
+            std::vector<uint8_t> input(static_cast<size_t>(input_width) * previous.rows * 4);
+            for (int y = 0; y < previous.rows; ++y)
+            {
+                const uint8_t* row = previous.Row(previous.first_row + y);
+                uint8_t* out = &input[static_cast<size_t>(y) * input_width * 4];
+                for (int x = 0; x < input_width; ++x)
+                {
+                    int source_x = std::clamp((column_begin - FILTER_MARGIN) * 2 + x, 0, previous.width - 1);
+                    memcpy(out + static_cast<size_t>(x) * 4, row + static_cast<size_t>(source_x) * 4, 4);
+                }
+            }
+
+            MipLevel output = GenerateMipLevel(input.data(), input_width, previous.rows, 4, options_.mip_options);
+            size_t copy_bytes = static_cast<size_t>(column_end - column_begin) * 4;
+            for (int y = first; y < last; ++y)
+            {
+                size_t output_row = static_cast<size_t>(y - first + FILTER_MARGIN);
+                memcpy(band.Row(y) + static_cast<size_t>(column_begin) * 4,
+                       &output.pixels[(output_row * columns + FILTER_MARGIN) * 4], copy_bytes);
+            }
+        };
+
+        if (!pool_ || width <= CHUNK_COLUMNS)
+        {
+            run(0, width);
+            return true;
+        }
+
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        int remaining = 0;
+        for (int column = 0; column < width; column += CHUNK_COLUMNS)
+        {
+            int column_end = std::min(width, column + CHUNK_COLUMNS);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++remaining;
+            }
+            pool_->Submit([&, column, column_end] {
+                run(column, column_end);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--remaining == 0)
+                {
+                    done_cv.notify_one();
+                }
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] { return remaining == 0; });
+        return true;
+    }
+
+    // 从 band 里切出第 ty 行的所有瓦片，超出图片的部分夹到边缘
+    void CutTiles(Level const& info, uint32_t ty, Band const& band, uint8_t* out) const
+    {
+        int tile_size = options_.tile_size;
+        int border = options_.border;
+        int width = static_cast<int>(info.width);
+        int height = static_cast<int>(info.height);
+        for (uint32_t tx = 0; tx < info.tiles_x; ++tx)
+        {
+            uint8_t* tile = out + tx * tile_bytes_;
+            int x0 = static_cast<int>(tx) * tile_size - border;
+            int y0 = static_cast<int>(ty) * tile_size - border;
+            // 只有第一块和最后一块会超出左右边缘，中间一段可以整段拷贝
+            int inner_begin = std::clamp(-x0, 0, slot_size_);
+            int inner_end = std::clamp(width - x0, inner_begin, slot_size_);
+            for (int py = 0; py < slot_size_; ++py)
+            {
+                const uint8_t* row = band.Row(std::clamp(y0 + py, 0, height - 1));
+                uint8_t* target = tile + static_cast<size_t>(py) * slot_size_ * 4;
+                for (int px = 0; px < inner_begin; ++px)
+                {
+                    memcpy(target + static_cast<size_t>(px) * 4, row, 4);
+                }
+                memcpy(target + static_cast<size_t>(inner_begin) * 4, row + static_cast<size_t>(x0 + inner_begin) * 4,
+                       static_cast<size_t>(inner_end - inner_begin) * 4);
+                for (int px = inner_end; px < slot_size_; ++px)
+                {
+                    memcpy(target + static_cast<size_t>(px) * 4, row + static_cast<size_t>(width - 1) * 4, 4);
+                }
+            }
+        }
+    }
+
+    bool ReadAt(size_t offset, uint8_t* data, size_t size)
+    {
+        file_.seekg(static_cast<std::streamoff>(offset));
+        file_.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file_);
+    }
+
+    // 按偏移递增的顺序调用，级别之间的对齐空隙补 0
+    bool WriteAt(size_t offset, const uint8_t* data, size_t size)
+    {
+        static const char padding[ALIGNMENT] = {};
+        file_.seekp(static_cast<std::streamoff>(written_));
+        if (offset > written_)
+        {
+            file_.write(padding, static_cast<std::streamsize>(offset - written_));
+        }
+        file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written_ = offset + size;
+        return static_cast<bool>(file_);
+    }
+
+private:
+    // 已经写到的位置
+    size_t written_ = 0;
+    std::fstream& file_;
+    SourceImage const& source_;
+    BuildOptions const& options_;
+    std::vector<Level> const& levels_;
+    ThreadPool* pool_ = nullptr;
+    int slot_size_ = 0;
+    size_t tile_bytes_ = 0;
+};
+
+} // namespace
+
+bool Parse(const void* data, size_t size, View& view, std::string* error)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (size < sizeof(Header))
+    {
+        return Fail(error, "file is too small");
+    }
+
+    auto header = reinterpret_cast<Header const*>(bytes);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return Fail(error, "not a tiled image");
+    }
+    if (header->version != VERSION)
+    {
+        return Fail(error, "unsupported version " + std::to_string(header->version));
+    }
+    if (header->width == 0 || header->height == 0 || header->tile_size == 0 || header->tile_size > 4096 ||
+        header->border >= header->tile_size || header->level_count == 0 || header->level_count > 32)
+    {
+        return Fail(error, "invalid header");
+    }
+
+    size_t table_end = sizeof(Header) + sizeof(Level) * header->level_count;
+    if (size < table_end)
+    {
+        return Fail(error, "truncated level table");
+    }
+
+    // 级别表完全由头部决定，逐项比较即可校验偏移和范围
+    size_t slot_size = header->tile_size + header->border * 2;
+    size_t tile_bytes = slot_size * slot_size * 4;
+    std::vector<Level> expected = Layout(header->width, header->height, header->tile_size, tile_bytes);
+    auto levels = reinterpret_cast<Level const*>(bytes + sizeof(Header));
+    if (expected.size() != header->level_count)
+    {
+        return Fail(error, "invalid level count");
+    }
+    for (uint32_t i = 0; i < header->level_count; ++i)
+    {
+        Level const& level = levels[i];
+        if (memcmp(&level, &expected[i], sizeof(Level)) != 0 || LevelEnd(level, tile_bytes) > size)
+        {
+            return Fail(error, "invalid level " + std::to_string(i));
+        }
+    }
+
+    view.header = header;
+    view.levels = levels;
+    view.data = bytes;
+    return true;
+}
+
+bool ParsePnm(const void* data, size_t size, SourceImage& image, std::string* error)
+{
+    const char* text = static_cast<const char*>(data);
+    if (size < 2 || text[0] != 'P' || (text[1] != '5' && text[1] != '6'))
+    {
+        return Fail(error, "not a binary PGM / PPM file");
+    }
+
+    // 宽、高、最大值，之间是空白或 # 开头的注释，最大值之后正好一个空白字符
+    size_t position = 2;
+    long values[3] = {};
+    for (long& value : values)
+    {
+        while (position < size && (isspace(static_cast<unsigned char>(text[position])) || text[position] == '#'))
+        {
+            if (text[position] == '#')
+            {
+                while (position < size && text[position] != '\n')
+                {
+                    ++position;
+                }
+            }
+            else
+            {
+                ++position;
+            }
+        }
+        if (position >= size || !isdigit(static_cast<unsigned char>(text[position])))
+        {
+            return Fail(error, "invalid header");
+        }
+        while (position < size && isdigit(static_cast<unsigned char>(text[position])) && value <= INT32_MAX)
+        {
+            value = value * 10 + (text[position++] - '0');
+        }
+    }
+    if (values[0] <= 0 || values[1] <= 0 || values[0] > INT32_MAX || values[1] > INT32_MAX)
+    {
+        return Fail(error, "invalid size");
+    }
+    if (values[2] != 255)
+    {
+        return Fail(error, "only 8-bit images are supported");
+    }
+    if (position >= size || !isspace(static_cast<unsigned char>(text[position])))
+    {
+        return Fail(error, "invalid header");
+    }
+    ++position;
+
+    int channels = text[1] == '5' ? 1 : 3;
+    size_t pixel_bytes = static_cast<size_t>(values[0]) * static_cast<size_t>(values[1]) * channels;
+    if (size - position < pixel_bytes)
+    {
+        return Fail(error, "truncated pixel data");
+    }
+
+    image.pixels = static_cast<const uint8_t*>(data) + position;
+    image.width = static_cast<int>(values[0]);
+    image.height = static_cast<int>(values[1]);
+    image.channels = channels;
+    return true;
+}
+
+bool Write(std::string const& path, SourceImage const& source, BuildOptions const& options, ThreadPool* pool,
+           std::string* error)
+{
+    if (!source.pixels || source.width <= 0 || source.height <= 0 || source.channels < 1 || source.channels > 4)
+    {
+        return Fail(error, "nothing to write");
+    }
+    if (options.tile_size <= 0 || options.tile_size > 4096 || options.border < 0 ||
+        options.border >= options.tile_size)
+    {
+        return Fail(error, "invalid tile size");
+    }
+
+    size_t slot_size = static_cast<size_t>(options.tile_size + options.border * 2);
+    std::vector<Level> levels = Layout(static_cast<uint32_t>(source.width), static_cast<uint32_t>(source.height),
+                                       static_cast<uint32_t>(options.tile_size), slot_size * slot_size * 4);
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = static_cast<uint32_t>(source.width);
+    header.height = static_cast<uint32_t>(source.height);
+    header.tile_size = static_cast<uint32_t>(options.tile_size);
+    header.border = static_cast<uint32_t>(options.border);
+    header.level_count = static_cast<uint32_t>(levels.size());
+
+    // 先写临时文件再改名，中断时不会留下半个文件
+    std::filesystem::path target(path);
+    std::error_code ec;
+    if (target.has_parent_path())
+    {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+    std::string temp_path = path + ".tmp";
+    {
+        // 生成后面的级别时要读回前一级，读写同一个文件
+        std::fstream file(temp_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        if (!file)
+        {
+            return Fail(error, "cannot open " + temp_path);
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(levels.data()),
+                   static_cast<std::streamsize>(sizeof(Level) * levels.size()));
+        PyramidWriter writer(file, source, options, levels, pool, sizeof(header) + sizeof(Level) * levels.size());
+        for (uint32_t level = 0; level < levels.size(); ++level)
+        {
+            if (!file || !writer.WriteLevel(level))
+            {
+                file.close();
+                std::filesystem::remove(temp_path, ec);
+                return Fail(error, "write failed: " + temp_path);
+            }
+        }
+    }
+
+    std::filesystem::rename(temp_path, target, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return Fail(error, "cannot rename to " + path);
+    }
+    return true;
+}
+
+} // namespace tiled_image
+
+} // namespace utils
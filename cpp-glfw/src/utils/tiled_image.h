@@ -0,0 +1,109 @@
+#pragma once
+
+#include "mip_generator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace utils {
+
+class ThreadPool;
+
+// 分块金字塔图片（.gltiles），由 tile-pyramid 工具生成，用来查看远超 GL_MAX_TEXTURE_SIZE 的图片
+//
+// 布局（小端序）：Header，紧跟 level_count 个 Level，然后是各级的瓦片。第 0 级是原图，
+// 之后每级宽高减半（向上取整），直到一块瓦片就能放下整级。
+// 每块瓦片是 SlotSize() 见方的 RGBA8：中间 tile_size 见方是本块的像素，四周 border 个像素取自相邻的瓦片，
+// 超出图片的部分夹到边缘，放进缓存纹理后双线性采样不会混入相邻的槽位。
+// 瓦片大小固定，每级内按行优先排列，偏移可以直接由编号算出，查看时映射文件、按需读取可见的瓦片。
+namespace tiled_image {
+
+constexpr char MAGIC[4] = {'G', 'L', 'T', 'I'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t ALIGNMENT = 64;
+constexpr const char* EXTENSION = ".gltiles";
+// 加上两侧各 1 个像素的边框正好是 256
+constexpr int DEFAULT_TILE_SIZE = 254;
+constexpr int DEFAULT_BORDER = 1;
+
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t border;
+    uint32_t level_count;
+    uint32_t reserved;
+};
+
+struct Level
+{
+    // 第一块瓦片的偏移
+    uint64_t offset;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+};
+
+static_assert(sizeof(Header) == 32 && sizeof(Level) == 24, "tiled image layout must not depend on the compiler");
+
+// 指向映射内存的视图，不拥有数据
+struct View
+{
+    Header const* header = nullptr;
+    Level const* levels = nullptr;
+    const uint8_t* data = nullptr;
+
+    // 含边框的瓦片边长
+    int SlotSize() const
+    {
+        return static_cast<int>(header->tile_size + header->border * 2);
+    }
+
+    size_t TileBytes() const
+    {
+        return static_cast<size_t>(SlotSize()) * SlotSize() * 4;
+    }
+
+    const uint8_t* TilePixels(uint32_t level, uint32_t x, uint32_t y) const
+    {
+        Level const& info = levels[level];
+        return data + info.offset + (static_cast<size_t>(y) * info.tiles_x + x) * TileBytes();
+    }
+};
+
+// 校验头部和每一级的范围
+bool Parse(const void* data, size_t size, View& view, std::string* error = nullptr);
+
+// 紧密排列、自上而下的源图片，可以直接指向映射的文件
+struct SourceImage
+{
+    const uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+};
+
+// 解析二进制 PGM（P5）/ PPM（P6）的头部，最大值必须是 255。像素紧跟在头部之后，
+// 映射文件后可以直接作为 SourceImage 使用，不需要把整张图片解码进内存
+bool ParsePnm(const void* data, size_t size, SourceImage& image, std::string* error = nullptr);
+
+struct BuildOptions
+{
+    int tile_size = DEFAULT_TILE_SIZE;
+    int border = DEFAULT_BORDER;
+    // 逐级缩小时的滤波，见 MipOptions
+    MipOptions mip_options;
+};
+
+// 逐个瓦片行生成：第 0 级直接从 source 取，之后每级从正在写的文件里读回上一级相应的几行再缩小。
+// 内存占用只和图片宽度成正比，与高度无关。pool 不为空时每一行按列分段并行缩小
+bool Write(std::string const& path, SourceImage const& source, BuildOptions const& options,
+           ThreadPool* pool = nullptr, std::string* error = nullptr);
+
+} // namespace tiled_image
+
+} // namespace utils
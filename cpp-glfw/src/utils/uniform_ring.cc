@@ -0,0 +1,153 @@
+#include "uniform_ring.h"
+#include "gl_state.h"
+#include "std140.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+// GL_ARB_buffer_storage，glad 生成时没有包含扩展，这里手动补上
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#define ASSERT assert
+
+namespace utils {
+
+namespace {
+
+using BufferStorageProc = void(APIENTRYP)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+BufferStorageProc GetBufferStorage()
+{
+    static const BufferStorageProc buffer_storage = []() -> BufferStorageProc {
+        if (!glfwExtensionSupported("GL_ARB_buffer_storage"))
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<BufferStorageProc>(glfwGetProcAddress("glBufferStorage"));
+    }();
+    return buffer_storage;
+}
+
+} // namespace
+
+UniformRing::~UniformRing()
+{
+    ASSERT(buffer_ == 0 && "UniformRing::Release must be called before the context is destroyed");
+}
+
+bool UniformRing::Create(size_t bytes_per_frame)
+{
+    Release();
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment_ = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+    segment_size_ = std140::AlignUp(bytes_per_frame, alignment_);
+    size_t total_size = segment_size_ * FRAME_LATENCY;
+
+    auto& gl_state = GLStateCache::Current();
+    glGenBuffers(1, &buffer_);
+    gl_state.BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    if (auto buffer_storage = GetBufferStorage())
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        buffer_storage(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(total_size), nullptr, flags);
+        mapped_ = static_cast<uint8_t*>(
+            glMapBufferRange(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(total_size), flags));
+    }
+
+    if (!mapped_)
+    {
+        glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(total_size), nullptr, GL_DYNAMIC_DRAW);
+    }
+    gl_state.BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    segment_ = 0;
+    head_ = 0;
+    return true;
+}
+
+void UniformRing::Release()
+{
+    for (GLsync& fence : fences_)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (buffer_)
+    {
+        auto& gl_state = GLStateCache::Current();
+        if (mapped_)
+        {
+            gl_state.BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            gl_state.BindBuffer(GL_UNIFORM_BUFFER, 0);
+            mapped_ = nullptr;
+        }
+        gl_state.DeleteBuffers(1, &buffer_);
+        buffer_ = 0;
+    }
+}
+
+void UniformRing::BeginFrame()
+{
+    segment_ = (segment_ + 1) % FRAME_LATENCY;
+    head_ = 0;
+
+    // 正常情况下这一段在 FRAME_LATENCY 帧之前就已经用完，只有 GPU 严重落后时才会等待
+    GLsync& fence = fences_[segment_];
+    if (fence)
+    {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void UniformRing::EndFrame()
+{
+    ASSERT(!fences_[segment_]);
+    fences_[segment_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UniformRing::Allocation UniformRing::Push(const void* data, size_t size)
+{
+    ASSERT(buffer_);
+    if (head_ + size > segment_size_)
+    {
+        std::cout << "ERROR: UniformRing overflow, increase bytes_per_frame (" << segment_size_ << ")\n";
+        return {};
+    }
+
+    Allocation allocation{static_cast<GLintptr>(segment_ * segment_size_ + head_), static_cast<GLsizeiptr>(size)};
+    if (mapped_)
+    {
+        memcpy(mapped_ + allocation.offset, data, size);
+    }
+    else
+    {
+        // 通用绑定点不影响 block 的绑定，不必恢复为 0
+        GLStateCache::Current().BindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, allocation.offset, allocation.size, data);
+    }
+
+    head_ = std140::AlignUp(head_ + size, alignment_);
+    return allocation;
+}
+
+void UniformRing::Bind(GLuint binding, Allocation allocation) const
+{
+    GLStateCache::Current().BindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_, allocation.offset, allocation.size);
+}
+
+} // namespace utils
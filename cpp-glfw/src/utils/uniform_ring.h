@@ -0,0 +1,71 @@
+#pragma once
+
+#include "gl_include.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace utils {
+
+// 每帧的 uniform 数据写进一个环形的 uniform buffer，用 glBindBufferRange 绑定到 block
+//
+// 缓冲区分成 FRAME_LATENCY 段，每帧写一段；帧末插入 fence，再次轮到这一段时先等它完成，
+// 所以写入时不会覆盖 GPU 还在读的数据，也不需要每次 glBufferData 重新分配。
+// 支持 GL_ARB_buffer_storage（或 GL 4.4）时整个缓冲区持久映射（persistent + coherent），
+// Push 只是一次 memcpy；否则退回到 glBufferSubData。
+class UniformRing
+{
+public:
+    static constexpr int FRAME_LATENCY = 3;
+
+    struct Allocation
+    {
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    UniformRing() = default;
+    ~UniformRing();
+
+    UniformRing(UniformRing const&) = delete;
+    UniformRing& operator=(UniformRing const&) = delete;
+
+    // bytes_per_frame 为一帧内所有 Push 的总量上限（按 GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 对齐后）
+    bool Create(size_t bytes_per_frame);
+    // 必须在 GL 上下文销毁前调用
+    void Release();
+
+    // 每帧第一次 Push 之前调用
+    void BeginFrame();
+    // 这一帧最后一次使用 ring 中的数据绘制之后调用
+    void EndFrame();
+
+    Allocation Push(const void* data, size_t size);
+
+    template <typename T>
+    Allocation Push(T const& block)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "uniform blocks must be trivially copyable");
+        return Push(&block, sizeof(T));
+    }
+
+    // 把 allocation 绑定到 uniform block 绑定点（见 Shader::BindUniformBlock）
+    void Bind(GLuint binding, Allocation allocation) const;
+
+    bool IsPersistent() const
+    {
+        return mapped_ != nullptr;
+    }
+
+private:
+    GLuint buffer_ = 0;
+    uint8_t* mapped_ = nullptr;
+    size_t alignment_ = 256;
+    size_t segment_size_ = 0;
+    int segment_ = 0;
+    size_t head_ = 0;
+    std::array<GLsync, FRAME_LATENCY> fences_{};
+};
+
+} // namespace utils